@@ -0,0 +1,186 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <queue>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "graph.h"
+#include "lower_bounds.h"
+#include "router.h"
+
+namespace graph {
+    // point to point search ordered by the route weight plus a lower bound of the rest of the route,
+    // so it settles mostly the vertices lying towards the target
+    template <typename Weight>
+    class AStarRouter : public RouterInterface<Weight> {
+    private:        // names
+        using Graph = DirectedWeightedGraph<Weight>;
+
+        // the state of a search, valid for the vertices stamped with stamp; every thread keeps its own
+        // from query to query, so that the queries run concurrently and allocate nothing
+        struct SearchState {
+            std::vector<Weight> weights;
+            std::vector<Weight> bounds;
+            std::vector<EdgeId> prev_edges;
+            std::vector<uint32_t> stamps;
+            uint32_t stamp = 0;
+            size_t settled_count = 0;
+
+            bool IsReached(VertexId vertex) const { return stamps[vertex] == stamp; }
+        };
+
+    public:         // constructors
+        AStarRouter(const Graph& graph, std::unique_ptr<const LowerBound<Weight>> lower_bound);
+
+    public:         // methods
+        using RouteInfo = typename RouterInterface<Weight>::RouteInfo;
+        std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const override;
+        using WeightsTable = typename RouterInterface<Weight>::WeightsTable;
+        WeightsTable BuildWeights(const std::vector<VertexId>& sources, const std::vector<VertexId>& targets) const override;
+
+        const LowerBound<Weight>& GetLowerBound() const { return *lower_bound_; }
+        // the vertices settled by the last search of the calling thread
+        size_t GetSettledCount() const { return GetThreadState().settled_count; }
+
+    private:
+        // without a target it is a plain one-to-all search; the state is the one of the calling thread
+        const SearchState& Search(VertexId from, std::optional<VertexId> target) const;
+        void CheckVertex(VertexId vertex) const;
+        static SearchState& GetThreadState();
+        static constexpr Weight ZERO_WEIGHT{};
+        using RouterInterface<Weight>::UNREACHABLE;
+        static constexpr EdgeId NO_EDGE = std::numeric_limits<EdgeId>::max();
+        const Graph& graph_;
+        std::unique_ptr<const LowerBound<Weight>> lower_bound_;
+    };
+
+    template <typename Weight>
+    AStarRouter<Weight>::AStarRouter(const Graph& graph, std::unique_ptr<const LowerBound<Weight>> lower_bound)
+        : graph_(graph)
+        , lower_bound_(std::move(lower_bound))
+    {
+        for (EdgeId edge_id = 0; edge_id < graph.GetEdgeCount(); ++edge_id) {
+            if (graph.GetEdge(edge_id).weight < ZERO_WEIGHT) {
+                throw std::domain_error("Edges' weights should be non-negative");
+            }
+        }
+    }
+
+    template <typename Weight>
+    typename AStarRouter<Weight>::SearchState& AStarRouter<Weight>::GetThreadState() {
+        thread_local SearchState state;
+        return state;
+    }
+
+    template <typename Weight>
+    void AStarRouter<Weight>::CheckVertex(VertexId vertex) const {
+        if (vertex >= graph_.GetVertexCount()) {
+            throw std::out_of_range("Vertex is out of the graph");
+        }
+    }
+
+    template <typename Weight>
+    const typename AStarRouter<Weight>::SearchState& AStarRouter<Weight>::Search(VertexId from,
+        std::optional<VertexId> target) const {
+        // (weight + bound, weight, vertex)
+        using QueueItem = std::tuple<Weight, Weight, VertexId>;
+        SearchState& state = GetThreadState();
+        const size_t vertex_count = graph_.GetVertexCount();
+        // the state may have been left by a router of a smaller graph, the stamps it gets are not stamp
+        if (state.stamps.size() < vertex_count) {
+            state.weights.resize(vertex_count);
+            state.bounds.resize(vertex_count);
+            state.prev_edges.resize(vertex_count);
+            state.stamps.resize(vertex_count, 0);
+        }
+        if (++state.stamp == 0) {
+            std::fill(state.stamps.begin(), state.stamps.end(), 0);
+            state.stamp = 1;
+        }
+        state.settled_count = 0;
+        std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<QueueItem>> queue;
+
+        // vertices that can not reach the target get UNREACHABLE as a bound and are never queued
+        auto reach = [&](VertexId vertex, Weight weight, EdgeId edge_id) {
+            if (!state.IsReached(vertex)) {
+                state.stamps[vertex] = state.stamp;
+                state.bounds[vertex] = target ? lower_bound_->Estimate(vertex, *target) : ZERO_WEIGHT;
+            }
+            else if (!(weight < state.weights[vertex])) {
+                return;
+            }
+            state.weights[vertex] = weight;
+            state.prev_edges[vertex] = edge_id;
+            if (state.bounds[vertex] != UNREACHABLE) {
+                queue.push({ weight + state.bounds[vertex], weight, vertex });
+            }
+        };
+
+        reach(from, ZERO_WEIGHT, NO_EDGE);
+        while (!queue.empty()) {
+            const auto [priority, weight, vertex] = queue.top();
+            queue.pop();
+            if (state.weights[vertex] < weight) {
+                continue;
+            }
+            ++state.settled_count;
+            if (target && vertex == *target) {
+                break;
+            }
+            for (const IncidentEdge<Weight>& edge : graph_.GetIncidentEdges(vertex)) {
+                reach(edge.to, weight + edge.weight, edge.id);
+            }
+        }
+        return state;
+    }
+
+    template <typename Weight>
+    std::optional<typename AStarRouter<Weight>::RouteInfo> AStarRouter<Weight>::BuildRoute(VertexId from,
+        VertexId to) const {
+        CheckVertex(from);
+        CheckVertex(to);
+        if (from == to) {
+            return RouteInfo{ ZERO_WEIGHT, {} };
+        }
+        const SearchState& state = Search(from, to);
+        if (!state.IsReached(to)) {
+            return std::nullopt;
+        }
+        std::vector<EdgeId> edges;
+        for (EdgeId edge_id = state.prev_edges[to]; edge_id != NO_EDGE; edge_id = state.prev_edges[graph_.GetEdge(edge_id).from]) {
+            edges.push_back(edge_id);
+        }
+        std::reverse(edges.begin(), edges.end());
+
+        return RouteInfo{ state.weights[to], std::move(edges) };
+    }
+
+    template <typename Weight>
+    typename AStarRouter<Weight>::WeightsTable AStarRouter<Weight>::BuildWeights(const std::vector<VertexId>& sources,
+        const std::vector<VertexId>& targets) const {
+        for (const std::vector<VertexId>* vertices : { &sources, &targets }) {
+            for (const VertexId vertex : *vertices) {
+                CheckVertex(vertex);
+            }
+        }
+        // there is no single target to head for, one full search per source answers all of them
+        WeightsTable table(sources.size(), std::vector<std::optional<Weight>>(targets.size()));
+        for (size_t i = 0; i < sources.size(); ++i) {
+            const SearchState& state = Search(sources[i], std::nullopt);
+            for (size_t j = 0; j < targets.size(); ++j) {
+                if (state.IsReached(targets[j])) {
+                    table[i][j] = state.weights[targets[j]];
+                }
+            }
+        }
+        return table;
+    }
+}       // namespace graph
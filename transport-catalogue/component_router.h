@@ -0,0 +1,357 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <numeric>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "graph.h"
+#include "router.h"
+#include "thread_pool.h"
+
+namespace graph {
+    // routes matrices of the weakly connected components of the graph: no route leaves a component,
+    // so only n_i x n_i cells are kept for each of them instead of V x V for the whole graph,
+    // and a route between two components is not found without looking at any matrix
+    template <typename Weight>
+    class ComponentRouter : public RouterInterface<Weight> {
+    private:        // names
+        using Graph = DirectedWeightedGraph<Weight>;
+
+        // the vertices and edges of a component are numbered in the order of their ids in the graph
+        struct Component {
+            size_t vertex_count = 0;
+            std::vector<EdgeId> edges;                  // graph edges by the component's edge ids
+            std::unique_ptr<Graph> graph;               // null if the component is the whole graph
+            std::unique_ptr<Router<Weight>> router;
+        };
+
+    public:         // names
+        using PrevEdge = typename Router<Weight>::PrevEdge;
+
+        // the routes matrix of a component, vertex_count x vertex_count cells
+        struct Block {
+            const Weight* weights;
+            const PrevEdge* prev_edges;
+            size_t cell_count;
+        };
+
+        // the blocks of all the components one after another, owned by someone else; storage keeps them alive
+        struct BlocksView {
+            size_t cell_count;
+            const Weight* weights;
+            const PrevEdge* prev_edges;
+            std::shared_ptr<const void> storage;
+        };
+
+    public:         // constructors
+        // with a thread pool the big components use all of its threads and the small ones go side by side
+        explicit ComponentRouter(const Graph& graph, concurrency::ThreadPool* pool = nullptr);
+        // a view of V x V cells (put together from a sharded build) is used as the only block of the whole graph
+        ComponentRouter(const Graph& graph, BlocksView blocks_view);
+
+    public:         // methods
+        using RouteInfo = typename RouterInterface<Weight>::RouteInfo;
+        std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const override;
+        using WeightsTable = typename RouterInterface<Weight>::WeightsTable;
+        WeightsTable BuildWeights(const std::vector<VertexId>& sources, const std::vector<VertexId>& targets) const override;
+        using ReachedVertices = typename RouterInterface<Weight>::ReachedVertices;
+        ReachedVertices BuildReachable(VertexId from, size_t vertex_count, Weight max_weight) const override;
+
+        // updates the routes with the edges just added to the graph; false if an edge joins two components,
+        // the router has to be built again then
+        bool AddEdges(const std::vector<EdgeId>& edge_ids, concurrency::ThreadPool* pool = nullptr);
+
+        size_t GetComponentCount() const { return components_.size(); }
+        std::vector<Block> GetBlocks() const;
+        // the components only depend on the edges, so any graph with them will do
+        template <typename GraphWeight>
+        static size_t EstimateMemory(const DirectedWeightedGraph<GraphWeight>& graph);
+
+    private:
+        // the component of every vertex, the components go in the order of their smallest vertices
+        template <typename GraphWeight>
+        static std::vector<uint32_t> FindComponents(const DirectedWeightedGraph<GraphWeight>& graph);
+        static std::vector<size_t> CountComponentVertices(const std::vector<uint32_t>& component_of);
+        void SplitGraph();
+        void UseWholeGraph();
+        const Graph& GetGraph(const Component& component) const { return component.graph ? *component.graph : graph_; }
+        void CheckVertex(VertexId vertex) const;
+        // components of fewer vertices fit into a few blocks of the matrix and gain nothing from more threads
+        static constexpr size_t PARALLEL_COMPONENT_SIZE = 256;
+        const Graph& graph_;
+        std::vector<uint32_t> component_of_;
+        std::vector<VertexId> local_ids_;           // the ids of the vertices in their components
+        std::vector<Component> components_;
+    };
+
+    template <typename Weight>
+    template <typename GraphWeight>
+    std::vector<uint32_t> ComponentRouter<Weight>::FindComponents(const DirectedWeightedGraph<GraphWeight>& graph) {
+        std::vector<VertexId> parents(graph.GetVertexCount());
+        std::iota(parents.begin(), parents.end(), 0);
+        auto find_root = [&parents](VertexId vertex) {
+            while (parents[vertex] != vertex) {
+                parents[vertex] = parents[parents[vertex]];
+                vertex = parents[vertex];
+            }
+            return vertex;
+        };
+        // the smaller root is kept, so a root is the smallest vertex of its component
+        for (EdgeId edge_id = 0; edge_id < graph.GetEdgeCount(); ++edge_id) {
+            const Edge<GraphWeight>& edge = graph.GetEdge(edge_id);
+            const VertexId from_root = find_root(edge.from);
+            const VertexId to_root = find_root(edge.to);
+            if (from_root != to_root) {
+                parents[std::max(from_root, to_root)] = std::min(from_root, to_root);
+            }
+        }
+        std::vector<uint32_t> component_of(graph.GetVertexCount());
+        uint32_t component_count = 0;
+        for (VertexId vertex = 0; vertex < graph.GetVertexCount(); ++vertex) {
+            const VertexId root = find_root(vertex);
+            component_of[vertex] = root == vertex ? component_count++ : component_of[root];
+        }
+        return component_of;
+    }
+
+    template <typename Weight>
+    std::vector<size_t> ComponentRouter<Weight>::CountComponentVertices(const std::vector<uint32_t>& component_of) {
+        std::vector<size_t> counts;
+        for (const uint32_t component : component_of) {
+            if (component == counts.size()) {
+                counts.push_back(0);
+            }
+            ++counts[component];
+        }
+        return counts;
+    }
+
+    template <typename Weight>
+    void ComponentRouter<Weight>::SplitGraph() {
+        const std::vector<size_t> vertex_counts = CountComponentVertices(component_of_);
+        if (vertex_counts.size() == 1) {
+            UseWholeGraph();
+            return;
+        }
+        components_.resize(vertex_counts.size());
+        local_ids_.resize(component_of_.size());
+        for (size_t i = 0; i < components_.size(); ++i) {
+            components_[i].graph = std::make_unique<Graph>(vertex_counts[i]);
+        }
+        for (VertexId vertex = 0; vertex < component_of_.size(); ++vertex) {
+            local_ids_[vertex] = components_[component_of_[vertex]].vertex_count++;
+        }
+        for (EdgeId edge_id = 0; edge_id < graph_.GetEdgeCount(); ++edge_id) {
+            const Edge<Weight>& edge = graph_.GetEdge(edge_id);
+            Component& component = components_[component_of_[edge.from]];
+            component.graph->AddEdge({ local_ids_[edge.from], local_ids_[edge.to], edge.weight });
+            component.edges.push_back(edge_id);
+        }
+        for (Component& component : components_) {
+            component.graph->Finalize();
+        }
+    }
+
+    // the ids stay those of the graph, whatever its components are
+    template <typename Weight>
+    void ComponentRouter<Weight>::UseWholeGraph() {
+        component_of_.assign(graph_.GetVertexCount(), 0);
+        local_ids_.resize(graph_.GetVertexCount());
+        std::iota(local_ids_.begin(), local_ids_.end(), 0);
+        components_.clear();
+        components_.emplace_back();
+        components_.back().vertex_count = graph_.GetVertexCount();
+    }
+
+    template <typename Weight>
+    ComponentRouter<Weight>::ComponentRouter(const Graph& graph, concurrency::ThreadPool* pool)
+        : graph_(graph)
+        , component_of_(FindComponents(graph))
+    {
+        SplitGraph();
+        std::vector<size_t> small_components;
+        for (size_t i = 0; i < components_.size(); ++i) {
+            Component& component = components_[i];
+            if (component.vertex_count >= PARALLEL_COMPONENT_SIZE) {
+                component.router = std::make_unique<Router<Weight>>(GetGraph(component), pool);
+            }
+            else {
+                small_components.push_back(i);
+            }
+        }
+        concurrency::ParallelFor(pool, small_components.size(), [&](size_t i) {
+            Component& component = components_[small_components[i]];
+            component.router = std::make_unique<Router<Weight>>(GetGraph(component));
+        });
+    }
+
+    template <typename Weight>
+    ComponentRouter<Weight>::ComponentRouter(const Graph& graph, BlocksView blocks_view)
+        : graph_(graph)
+        , component_of_(FindComponents(graph))
+    {
+        size_t cell_count = 0;
+        for (const size_t vertex_count : CountComponentVertices(component_of_)) {
+            cell_count += vertex_count * vertex_count;
+        }
+        if (blocks_view.cell_count == cell_count) {
+            SplitGraph();
+        }
+        else if (blocks_view.cell_count == graph.GetVertexCount() * graph.GetVertexCount()) {
+            UseWholeGraph();
+        }
+        else {
+            throw std::invalid_argument("Routes matrix does not match the graph");
+        }
+        size_t offset = 0;
+        for (Component& component : components_) {
+            component.router = std::make_unique<Router<Weight>>(GetGraph(component), typename Router<Weight>::RoutesView{
+                component.vertex_count, blocks_view.weights + offset, blocks_view.prev_edges + offset, blocks_view.storage });
+            offset += component.vertex_count * component.vertex_count;
+        }
+    }
+
+    template <typename Weight>
+    void ComponentRouter<Weight>::CheckVertex(VertexId vertex) const {
+        if (vertex >= component_of_.size()) {
+            throw std::out_of_range("Vertex is out of the routes matrix");
+        }
+    }
+
+    template <typename Weight>
+    std::optional<typename ComponentRouter<Weight>::RouteInfo> ComponentRouter<Weight>::BuildRoute(VertexId from,
+        VertexId to) const {
+        CheckVertex(from);
+        CheckVertex(to);
+        if (component_of_[from] != component_of_[to]) {
+            return std::nullopt;
+        }
+        const Component& component = components_[component_of_[from]];
+        std::optional<RouteInfo> route = component.router->BuildRoute(local_ids_[from], local_ids_[to]);
+        if (route && component.graph) {
+            for (EdgeId& edge_id : route->edges) {
+                edge_id = component.edges[edge_id];
+            }
+        }
+        return route;
+    }
+
+    // every component answers for its own sources and targets
+    template <typename Weight>
+    typename ComponentRouter<Weight>::WeightsTable ComponentRouter<Weight>::BuildWeights(
+        const std::vector<VertexId>& sources, const std::vector<VertexId>& targets) const {
+        std::vector<std::vector<size_t>> component_sources(components_.size());
+        std::vector<std::vector<size_t>> component_targets(components_.size());
+        for (size_t i = 0; i < sources.size(); ++i) {
+            CheckVertex(sources[i]);
+            component_sources[component_of_[sources[i]]].push_back(i);
+        }
+        for (size_t j = 0; j < targets.size(); ++j) {
+            CheckVertex(targets[j]);
+            component_targets[component_of_[targets[j]]].push_back(j);
+        }
+
+        WeightsTable table(sources.size(), std::vector<std::optional<Weight>>(targets.size()));
+        for (size_t component = 0; component < components_.size(); ++component) {
+            const std::vector<size_t>& source_indexes = component_sources[component];
+            const std::vector<size_t>& target_indexes = component_targets[component];
+            if (source_indexes.empty() || target_indexes.empty()) {
+                continue;
+            }
+            std::vector<VertexId> local_sources;
+            std::vector<VertexId> local_targets;
+            for (const size_t i : source_indexes) {
+                local_sources.push_back(local_ids_[sources[i]]);
+            }
+            for (const size_t j : target_indexes) {
+                local_targets.push_back(local_ids_[targets[j]]);
+            }
+            const WeightsTable weights = components_[component].router->BuildWeights(local_sources, local_targets);
+            for (size_t i = 0; i < source_indexes.size(); ++i) {
+                for (size_t j = 0; j < target_indexes.size(); ++j) {
+                    table[source_indexes[i]][target_indexes[j]] = weights[i][j];
+                }
+            }
+        }
+        return table;
+    }
+
+    // only the component of the source is scanned
+    template <typename Weight>
+    typename ComponentRouter<Weight>::ReachedVertices ComponentRouter<Weight>::BuildReachable(VertexId from,
+        size_t vertex_count, Weight max_weight) const {
+        CheckVertex(from);
+        const uint32_t component = component_of_[from];
+        // the local ids go in the order of the ids in the graph
+        std::vector<VertexId> vertices;
+        for (VertexId vertex = 0; vertex < std::min(vertex_count, component_of_.size()); ++vertex) {
+            if (component_of_[vertex] == component) {
+                vertices.push_back(vertex);
+            }
+        }
+        ReachedVertices reached = components_[component].router->BuildReachable(local_ids_[from], vertices.size(), max_weight);
+        for (auto& [vertex, weight] : reached) {
+            vertex = vertices[vertex];
+        }
+        return reached;
+    }
+
+    template <typename Weight>
+    bool ComponentRouter<Weight>::AddEdges(const std::vector<EdgeId>& edge_ids, concurrency::ThreadPool* pool) {
+        if (graph_.GetVertexCount() != component_of_.size()) {
+            throw std::logic_error("Vertices can not be added to the routes matrix");
+        }
+        for (const EdgeId edge_id : edge_ids) {
+            const Edge<Weight>& edge = graph_.GetEdge(edge_id);
+            if (component_of_[edge.from] != component_of_[edge.to]) {
+                return false;
+            }
+        }
+        if (components_.size() == 1 && !components_.back().graph) {
+            components_.back().router->AddEdges(edge_ids, pool);
+            return true;
+        }
+
+        std::vector<std::vector<EdgeId>> component_edges(components_.size());
+        for (const EdgeId edge_id : edge_ids) {
+            const Edge<Weight>& edge = graph_.GetEdge(edge_id);
+            Component& component = components_[component_of_[edge.from]];
+            component_edges[component_of_[edge.from]].push_back(
+                component.graph->AddEdge({ local_ids_[edge.from], local_ids_[edge.to], edge.weight }));
+            component.edges.push_back(edge_id);
+        }
+        for (size_t i = 0; i < components_.size(); ++i) {
+            if (!component_edges[i].empty()) {
+                components_[i].graph->Finalize();
+                components_[i].router->AddEdges(component_edges[i], pool);
+            }
+        }
+        return true;
+    }
+
+    template <typename Weight>
+    std::vector<typename ComponentRouter<Weight>::Block> ComponentRouter<Weight>::GetBlocks() const {
+        std::vector<Block> blocks;
+        blocks.reserve(components_.size());
+        for (const Component& component : components_) {
+            blocks.push_back({ component.router->GetWeights(), component.router->GetPrevEdges(),
+                               component.vertex_count * component.vertex_count });
+        }
+        return blocks;
+    }
+
+    template <typename Weight>
+    template <typename GraphWeight>
+    size_t ComponentRouter<Weight>::EstimateMemory(const DirectedWeightedGraph<GraphWeight>& graph) {
+        size_t memory = 0;
+        for (const size_t vertex_count : CountComponentVertices(FindComponents(graph))) {
+            memory += Router<Weight>::EstimateMemory(vertex_count);
+        }
+        return memory;
+    }
+}       // namespace graph
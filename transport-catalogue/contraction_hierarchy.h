@@ -0,0 +1,621 @@
+#pragma once
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <numeric>
+#include <optional>
+#include <queue>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include <transport_router.pb.h>
+
+#include "graph.h"
+#include "router.h"
+
+namespace graph {
+    // contracts vertices one by one, adding shortcut edges that keep the distances between the
+    // remaining vertices; a route is then found by two searches that only go up the hierarchy
+    template <typename Weight>
+    class ContractionHierarchy : public RouterInterface<Weight> {
+    private:        // names
+        using Graph = DirectedWeightedGraph<Weight>;
+
+        // an original edge of the graph (second == NO_EDGE, first is its id)
+        // or a shortcut replacing two hierarchy edges: first, then second
+        struct HierarchyEdge {
+            VertexId from;
+            VertexId to;
+            Weight weight;
+            EdgeId first;
+            EdgeId second;
+        };
+
+        struct Arc {
+            VertexId to;
+            Weight weight;
+            EdgeId edge;
+        };
+
+        struct SearchLabel {
+            Weight weight;
+            EdgeId edge;
+        };
+
+    public:         // constructors
+        explicit ContractionHierarchy(const Graph& graph);
+        ContractionHierarchy(const Graph& graph, const transport_catalog_serialize::ContractionHierarchyData& data);
+
+    public:         // methods
+        using RouteInfo = typename RouterInterface<Weight>::RouteInfo;
+        std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const override;
+        using WeightsTable = typename RouterInterface<Weight>::WeightsTable;
+        WeightsTable BuildWeights(const std::vector<VertexId>& sources, const std::vector<VertexId>& targets) const override;
+        // the upward search from the source within max_weight, then one sweep over the vertices from the highest
+        // rank down takes the downward arcs: a route goes up the hierarchy and then down
+        using ReachedVertices = typename RouterInterface<Weight>::ReachedVertices;
+        ReachedVertices BuildReachable(VertexId from, size_t vertex_count, Weight max_weight) const override;
+
+        transport_catalog_serialize::ContractionHierarchyData GetSerializeData() const;
+        size_t GetShortcutCount() const { return edges_.size() - original_edge_count_; }
+
+    private:        // preprocessing
+        class Contractor;
+        void BuildSearchGraph();
+
+    private:        // query
+        void UnpackEdge(EdgeId edge, std::vector<EdgeId>& edges) const;
+        template <typename Visitor>
+        void SearchUpward(VertexId start, const std::vector<size_t>& offsets, const std::vector<Arc>& arcs,
+            std::vector<Weight>& weights, Visitor&& visit, Weight max_weight = UNREACHABLE) const;
+
+    private:        // fields
+        static constexpr Weight ZERO_WEIGHT{};
+        using RouterInterface<Weight>::UNREACHABLE;
+        static constexpr EdgeId NO_EDGE = std::numeric_limits<EdgeId>::max();
+
+        size_t vertex_count_;
+        size_t original_edge_count_ = 0;
+        std::vector<uint32_t> ranks_;
+        std::vector<HierarchyEdge> edges_;
+        // upward arcs of the forward search and reversed downward arcs of the backward search
+        std::vector<size_t> up_offsets_;
+        std::vector<Arc> up_arcs_;
+        std::vector<size_t> down_offsets_;
+        std::vector<Arc> down_arcs_;
+        std::vector<VertexId> sweep_order_;        // the vertices from the highest rank down
+    };
+
+    template <typename Weight>
+    class ContractionHierarchy<Weight>::Contractor {
+    private:        // names
+        using QueueItem = std::pair<Weight, VertexId>;
+        using MinQueue = std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<QueueItem>>;
+
+        // the cheapest edge to or from a not yet contracted neighbor
+        struct Neighbor {
+            VertexId vertex;
+            EdgeId edge;
+        };
+
+        struct Shortcut {
+            VertexId from;
+            VertexId to;
+            Weight weight;
+            EdgeId first;
+            EdgeId second;
+        };
+
+    private:        // fields
+        // the witness search gives up after scanning this many edges and the shortcut is
+        // added even if it may be redundant; estimating a priority uses a cheaper search
+        static constexpr size_t CONTRACTION_SCAN_LIMIT = 1000;
+        static constexpr size_t PRIORITY_SCAN_LIMIT = 100;
+        // beyond this many neighbor pairs the shortcut count is estimated as the number of pairs
+        static constexpr size_t PRIORITY_SIMULATION_LIMIT = 256;
+
+        ContractionHierarchy& hierarchy_;
+        std::vector<std::vector<Neighbor>> out_neighbors_;
+        std::vector<std::vector<Neighbor>> in_neighbors_;
+        std::vector<int> contracted_neighbors_;
+        std::vector<Weight> witness_weights_;
+        std::vector<size_t> witness_stamps_;
+        std::vector<size_t> target_stamps_;
+        size_t witness_stamp_ = 0;
+
+    public:         // constructors
+        explicit Contractor(ContractionHierarchy& hierarchy);
+
+    public:         // methods
+        void Run();
+
+    private:        // methods
+        std::vector<Shortcut> FindShortcuts(VertexId vertex, size_t scan_limit);
+        // the search stops once all targets are settled
+        void RunWitnessSearch(VertexId source, VertexId excluded, const std::vector<VertexId>& targets,
+            Weight max_weight, size_t scan_limit);
+        Weight GetWitnessWeight(VertexId vertex) const;
+        int ComputePriority(VertexId vertex);
+        void ContractVertex(VertexId vertex);
+        void AddEdge(VertexId from, VertexId to, EdgeId edge_id);
+        static void RemoveNeighbor(std::vector<Neighbor>& neighbors, VertexId vertex);
+    };
+
+    template <typename Weight>
+    ContractionHierarchy<Weight>::Contractor::Contractor(ContractionHierarchy& hierarchy)
+        : hierarchy_(hierarchy)
+        , out_neighbors_(hierarchy.vertex_count_)
+        , in_neighbors_(hierarchy.vertex_count_)
+        , contracted_neighbors_(hierarchy.vertex_count_, 0)
+        , witness_weights_(hierarchy.vertex_count_, UNREACHABLE)
+        , witness_stamps_(hierarchy.vertex_count_, 0)
+        , target_stamps_(hierarchy.vertex_count_, 0)
+    {
+        for (EdgeId edge_id = 0; edge_id < hierarchy.edges_.size(); ++edge_id) {
+            const HierarchyEdge& edge = hierarchy.edges_[edge_id];
+            if (edge.from != edge.to) {
+                AddEdge(edge.from, edge.to, edge_id);
+            }
+        }
+    }
+
+    template <typename Weight>
+    void ContractionHierarchy<Weight>::Contractor::Run() {
+        using PriorityItem = std::pair<int, VertexId>;
+        std::priority_queue<PriorityItem, std::vector<PriorityItem>, std::greater<PriorityItem>> queue;
+        for (VertexId vertex = 0; vertex < hierarchy_.vertex_count_; ++vertex) {
+            queue.push({ ComputePriority(vertex), vertex });
+        }
+        uint32_t rank = 0;
+        while (!queue.empty()) {
+            const VertexId vertex = queue.top().second;
+            queue.pop();
+            // lazy update: the priority may have grown since the vertex was queued
+            const int priority = ComputePriority(vertex);
+            if (!queue.empty() && priority > queue.top().first) {
+                queue.push({ priority, vertex });
+                continue;
+            }
+            ContractVertex(vertex);
+            hierarchy_.ranks_[vertex] = rank++;
+        }
+    }
+
+    template <typename Weight>
+    void ContractionHierarchy<Weight>::Contractor::RunWitnessSearch(VertexId source, VertexId excluded,
+        const std::vector<VertexId>& targets, Weight max_weight, size_t scan_limit) {
+        ++witness_stamp_;
+        size_t target_count = targets.size();
+        for (const VertexId target : targets) {
+            target_stamps_[target] = witness_stamp_;
+        }
+        MinQueue queue;
+        witness_weights_[source] = ZERO_WEIGHT;
+        witness_stamps_[source] = witness_stamp_;
+        queue.push({ ZERO_WEIGHT, source });
+        size_t scanned_count = 0;
+        while (!queue.empty() && scanned_count < scan_limit && target_count > 0) {
+            const auto [weight, vertex] = queue.top();
+            queue.pop();
+            if (GetWitnessWeight(vertex) < weight) {
+                continue;
+            }
+            if (max_weight < weight) {
+                break;
+            }
+            if (target_stamps_[vertex] == witness_stamp_) {
+                --target_count;
+            }
+            scanned_count += out_neighbors_[vertex].size();
+            for (const Neighbor& neighbor : out_neighbors_[vertex]) {
+                if (neighbor.vertex == excluded) {
+                    continue;
+                }
+                const Weight candidate_weight = weight + hierarchy_.edges_[neighbor.edge].weight;
+                if (candidate_weight < GetWitnessWeight(neighbor.vertex)) {
+                    witness_weights_[neighbor.vertex] = candidate_weight;
+                    witness_stamps_[neighbor.vertex] = witness_stamp_;
+                    queue.push({ candidate_weight, neighbor.vertex });
+                }
+            }
+        }
+    }
+
+    template <typename Weight>
+    Weight ContractionHierarchy<Weight>::Contractor::GetWitnessWeight(VertexId vertex) const {
+        return witness_stamps_[vertex] == witness_stamp_ ? witness_weights_[vertex] : UNREACHABLE;
+    }
+
+    template <typename Weight>
+    std::vector<typename ContractionHierarchy<Weight>::Contractor::Shortcut>
+    ContractionHierarchy<Weight>::Contractor::FindShortcuts(VertexId vertex, size_t scan_limit) {
+        std::vector<Shortcut> shortcuts;
+        std::vector<VertexId> targets;
+        const std::vector<Neighbor>& out_neighbors = out_neighbors_[vertex];
+        for (const Neighbor& in_neighbor : in_neighbors_[vertex]) {
+            const Weight in_weight = hierarchy_.edges_[in_neighbor.edge].weight;
+            auto get_shortcut_weight = [&](const Neighbor& out_neighbor) {
+                return in_weight + hierarchy_.edges_[out_neighbor.edge].weight;
+            };
+
+            // most pairs are already connected by a cheap enough edge, only the rest need a search
+            ++witness_stamp_;
+            for (const Neighbor& neighbor : out_neighbors_[in_neighbor.vertex]) {
+                witness_weights_[neighbor.vertex] = hierarchy_.edges_[neighbor.edge].weight;
+                witness_stamps_[neighbor.vertex] = witness_stamp_;
+            }
+            targets.clear();
+            Weight max_weight = ZERO_WEIGHT;
+            for (const Neighbor& out_neighbor : out_neighbors) {
+                if (out_neighbor.vertex != in_neighbor.vertex
+                    && get_shortcut_weight(out_neighbor) < GetWitnessWeight(out_neighbor.vertex)) {
+                    targets.push_back(out_neighbor.vertex);
+                    max_weight = std::max(max_weight, get_shortcut_weight(out_neighbor));
+                }
+            }
+            if (targets.empty()) {
+                continue;
+            }
+
+            RunWitnessSearch(in_neighbor.vertex, vertex, targets, max_weight, scan_limit);
+            for (const Neighbor& out_neighbor : out_neighbors) {
+                if (out_neighbor.vertex != in_neighbor.vertex
+                    && get_shortcut_weight(out_neighbor) < GetWitnessWeight(out_neighbor.vertex)) {
+                    shortcuts.push_back({ in_neighbor.vertex, out_neighbor.vertex, get_shortcut_weight(out_neighbor),
+                                          in_neighbor.edge, out_neighbor.edge });
+                }
+            }
+        }
+        return shortcuts;
+    }
+
+    template <typename Weight>
+    int ContractionHierarchy<Weight>::Contractor::ComputePriority(VertexId vertex) {
+        const size_t pair_count = in_neighbors_[vertex].size() * out_neighbors_[vertex].size();
+        const int shortcut_count = static_cast<int>(pair_count > PRIORITY_SIMULATION_LIMIT
+            ? pair_count : FindShortcuts(vertex, PRIORITY_SCAN_LIMIT).size());
+        const int removed_count = static_cast<int>(in_neighbors_[vertex].size() + out_neighbors_[vertex].size());
+        return shortcut_count - removed_count + contracted_neighbors_[vertex];
+    }
+
+    template <typename Weight>
+    void ContractionHierarchy<Weight>::Contractor::ContractVertex(VertexId vertex) {
+        const std::vector<Shortcut> shortcuts = FindShortcuts(vertex, CONTRACTION_SCAN_LIMIT);
+        for (const Neighbor& neighbor : in_neighbors_[vertex]) {
+            RemoveNeighbor(out_neighbors_[neighbor.vertex], vertex);
+            ++contracted_neighbors_[neighbor.vertex];
+        }
+        for (const Neighbor& neighbor : out_neighbors_[vertex]) {
+            RemoveNeighbor(in_neighbors_[neighbor.vertex], vertex);
+            ++contracted_neighbors_[neighbor.vertex];
+        }
+        in_neighbors_[vertex].clear();
+        out_neighbors_[vertex].clear();
+        for (const Shortcut& shortcut : shortcuts) {
+            hierarchy_.edges_.push_back({ shortcut.from, shortcut.to, shortcut.weight, shortcut.first, shortcut.second });
+            AddEdge(shortcut.from, shortcut.to, hierarchy_.edges_.size() - 1);
+        }
+    }
+
+    // keeps only the cheapest edge between two vertices, the others can not be on a shortest route
+    template <typename Weight>
+    void ContractionHierarchy<Weight>::Contractor::AddEdge(VertexId from, VertexId to, EdgeId edge_id) {
+        const Weight weight = hierarchy_.edges_[edge_id].weight;
+        std::vector<Neighbor>& out_neighbors = out_neighbors_[from];
+        auto it = std::find_if(out_neighbors.begin(), out_neighbors.end(),
+            [to](const Neighbor& neighbor) { return neighbor.vertex == to; });
+        if (it == out_neighbors.end()) {
+            out_neighbors.push_back({ to, edge_id });
+            in_neighbors_[to].push_back({ from, edge_id });
+            return;
+        }
+        if (weight < hierarchy_.edges_[it->edge].weight) {
+            it->edge = edge_id;
+            std::vector<Neighbor>& in_neighbors = in_neighbors_[to];
+            std::find_if(in_neighbors.begin(), in_neighbors.end(),
+                [from](const Neighbor& neighbor) { return neighbor.vertex == from; })->edge = edge_id;
+        }
+    }
+
+    template <typename Weight>
+    void ContractionHierarchy<Weight>::Contractor::RemoveNeighbor(std::vector<Neighbor>& neighbors, VertexId vertex) {
+        auto it = std::find_if(neighbors.begin(), neighbors.end(),
+            [vertex](const Neighbor& neighbor) { return neighbor.vertex == vertex; });
+        if (it != neighbors.end()) {
+            *it = neighbors.back();
+            neighbors.pop_back();
+        }
+    }
+
+    template <typename Weight>
+    ContractionHierarchy<Weight>::ContractionHierarchy(const Graph& graph)
+        : vertex_count_(graph.GetVertexCount())
+        , original_edge_count_(graph.GetEdgeCount())
+        , ranks_(vertex_count_, 0)
+    {
+        edges_.reserve(original_edge_count_);
+        for (EdgeId edge_id = 0; edge_id < original_edge_count_; ++edge_id) {
+            const auto& edge = graph.GetEdge(edge_id);
+            if (edge.weight < ZERO_WEIGHT) {
+                throw std::domain_error("Edges' weights should be non-negative");
+            }
+            edges_.push_back({ edge.from, edge.to, edge.weight, edge_id, NO_EDGE });
+        }
+        Contractor(*this).Run();
+        BuildSearchGraph();
+    }
+
+    template <typename Weight>
+    ContractionHierarchy<Weight>::ContractionHierarchy(const Graph& graph,
+        const transport_catalog_serialize::ContractionHierarchyData& data)
+        : vertex_count_(graph.GetVertexCount())
+        , original_edge_count_(graph.GetEdgeCount())
+        , ranks_(data.ranks().begin(), data.ranks().end())
+    {
+        const int shortcut_count = data.shortcut_first_size();
+        if (ranks_.size() != vertex_count_ || data.shortcut_second_size() != shortcut_count) {
+            throw std::invalid_argument("Contraction hierarchy data does not match the graph");
+        }
+        edges_.reserve(original_edge_count_ + shortcut_count);
+        for (EdgeId edge_id = 0; edge_id < original_edge_count_; ++edge_id) {
+            const auto& edge = graph.GetEdge(edge_id);
+            edges_.push_back({ edge.from, edge.to, edge.weight, edge_id, NO_EDGE });
+        }
+        for (int i = 0; i < shortcut_count; ++i) {
+            const HierarchyEdge& first = edges_.at(data.shortcut_first(i));
+            const HierarchyEdge& second = edges_.at(data.shortcut_second(i));
+            edges_.push_back({ first.from, second.to, first.weight + second.weight,
+                               data.shortcut_first(i), data.shortcut_second(i) });
+        }
+        BuildSearchGraph();
+    }
+
+    template <typename Weight>
+    void ContractionHierarchy<Weight>::BuildSearchGraph() {
+        up_offsets_.assign(vertex_count_ + 1, 0);
+        down_offsets_.assign(vertex_count_ + 1, 0);
+        for (const HierarchyEdge& edge : edges_) {
+            if (ranks_[edge.from] < ranks_[edge.to]) {
+                ++up_offsets_[edge.from + 1];
+            }
+            else if (ranks_[edge.from] > ranks_[edge.to]) {
+                ++down_offsets_[edge.to + 1];
+            }
+        }
+        for (VertexId vertex = 0; vertex < vertex_count_; ++vertex) {
+            up_offsets_[vertex + 1] += up_offsets_[vertex];
+            down_offsets_[vertex + 1] += down_offsets_[vertex];
+        }
+        up_arcs_.resize(up_offsets_.back());
+        down_arcs_.resize(down_offsets_.back());
+        std::vector<size_t> up_positions(up_offsets_.begin(), up_offsets_.end() - 1);
+        std::vector<size_t> down_positions(down_offsets_.begin(), down_offsets_.end() - 1);
+        for (EdgeId edge_id = 0; edge_id < edges_.size(); ++edge_id) {
+            const HierarchyEdge& edge = edges_[edge_id];
+            if (ranks_[edge.from] < ranks_[edge.to]) {
+                up_arcs_[up_positions[edge.from]++] = { edge.to, edge.weight, edge_id };
+            }
+            else if (ranks_[edge.from] > ranks_[edge.to]) {
+                down_arcs_[down_positions[edge.to]++] = { edge.from, edge.weight, edge_id };
+            }
+        }
+        sweep_order_.resize(vertex_count_);
+        std::iota(sweep_order_.begin(), sweep_order_.end(), 0);
+        std::sort(sweep_order_.begin(), sweep_order_.end(), [this](VertexId lhs, VertexId rhs) {
+            return ranks_[lhs] > ranks_[rhs];
+        });
+    }
+
+    template <typename Weight>
+    transport_catalog_serialize::ContractionHierarchyData ContractionHierarchy<Weight>::GetSerializeData() const {
+        transport_catalog_serialize::ContractionHierarchyData data_out;
+        data_out.mutable_ranks()->Add(ranks_.begin(), ranks_.end());
+        for (EdgeId edge_id = original_edge_count_; edge_id < edges_.size(); ++edge_id) {
+            data_out.add_shortcut_first(static_cast<uint32_t>(edges_[edge_id].first));
+            data_out.add_shortcut_second(static_cast<uint32_t>(edges_[edge_id].second));
+        }
+        return data_out;
+    }
+
+    template <typename Weight>
+    void ContractionHierarchy<Weight>::UnpackEdge(EdgeId edge_id, std::vector<EdgeId>& edges) const {
+        std::vector<EdgeId> stack{ edge_id };
+        while (!stack.empty()) {
+            const HierarchyEdge& edge = edges_[stack.back()];
+            stack.pop_back();
+            if (edge.second == NO_EDGE) {
+                edges.push_back(edge.first);
+            }
+            else {
+                stack.push_back(edge.second);
+                stack.push_back(edge.first);
+            }
+        }
+    }
+
+    template <typename Weight>
+    std::optional<typename ContractionHierarchy<Weight>::RouteInfo> ContractionHierarchy<Weight>::BuildRoute(VertexId from,
+        VertexId to) const {
+        using QueueItem = std::pair<Weight, VertexId>;
+        using MinQueue = std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<QueueItem>>;
+        if (from >= vertex_count_ || to >= vertex_count_) {
+            throw std::out_of_range("Vertex is out of the contraction hierarchy");
+        }
+        if (from == to) {
+            return RouteInfo{ ZERO_WEIGHT, {} };
+        }
+
+        std::vector<SearchLabel> forward(vertex_count_, { UNREACHABLE, NO_EDGE });
+        std::vector<SearchLabel> backward(vertex_count_, { UNREACHABLE, NO_EDGE });
+        MinQueue forward_queue;
+        MinQueue backward_queue;
+        forward[from].weight = ZERO_WEIGHT;
+        backward[to].weight = ZERO_WEIGHT;
+        forward_queue.push({ ZERO_WEIGHT, from });
+        backward_queue.push({ ZERO_WEIGHT, to });
+        Weight best_weight = UNREACHABLE;
+        VertexId meeting_vertex = vertex_count_;
+
+        // settles one vertex of a direction and tries to meet the other one there
+        auto settle = [&](MinQueue& queue, std::vector<SearchLabel>& labels, const std::vector<SearchLabel>& other_labels,
+            const std::vector<size_t>& offsets, const std::vector<Arc>& arcs) {
+            const auto [weight, vertex] = queue.top();
+            queue.pop();
+            if (labels[vertex].weight < weight) {
+                return;
+            }
+            if (other_labels[vertex].weight != UNREACHABLE && weight + other_labels[vertex].weight < best_weight) {
+                best_weight = weight + other_labels[vertex].weight;
+                meeting_vertex = vertex;
+            }
+            for (size_t i = offsets[vertex]; i < offsets[vertex + 1]; ++i) {
+                const Arc& arc = arcs[i];
+                const Weight candidate_weight = weight + arc.weight;
+                if (candidate_weight < labels[arc.to].weight) {
+                    labels[arc.to] = { candidate_weight, arc.edge };
+                    queue.push({ candidate_weight, arc.to });
+                }
+            }
+        };
+
+        while (true) {
+            const bool forward_active = !forward_queue.empty() && forward_queue.top().first < best_weight;
+            const bool backward_active = !backward_queue.empty() && backward_queue.top().first < best_weight;
+            if (!forward_active && !backward_active) {
+                break;
+            }
+            if (forward_active && (!backward_active || forward_queue.top().first <= backward_queue.top().first)) {
+                settle(forward_queue, forward, backward, up_offsets_, up_arcs_);
+            }
+            else {
+                settle(backward_queue, backward, forward, down_offsets_, down_arcs_);
+            }
+        }
+        if (meeting_vertex == vertex_count_) {
+            return std::nullopt;
+        }
+
+        std::vector<EdgeId> hierarchy_edges;
+        for (VertexId vertex = meeting_vertex; forward[vertex].edge != NO_EDGE; vertex = edges_[forward[vertex].edge].from) {
+            hierarchy_edges.push_back(forward[vertex].edge);
+        }
+        std::reverse(hierarchy_edges.begin(), hierarchy_edges.end());
+        for (VertexId vertex = meeting_vertex; backward[vertex].edge != NO_EDGE; vertex = edges_[backward[vertex].edge].to) {
+            hierarchy_edges.push_back(backward[vertex].edge);
+        }
+        std::vector<EdgeId> edges;
+        for (const EdgeId edge_id : hierarchy_edges) {
+            UnpackEdge(edge_id, edges);
+        }
+        return RouteInfo{ best_weight, std::move(edges) };
+    }
+
+    // settles every vertex reachable from start by the given arcs within max_weight, calling visit(vertex, weight);
+    // weights must be UNREACHABLE everywhere and are restored before returning
+    template <typename Weight>
+    template <typename Visitor>
+    void ContractionHierarchy<Weight>::SearchUpward(VertexId start, const std::vector<size_t>& offsets,
+        const std::vector<Arc>& arcs, std::vector<Weight>& weights, Visitor&& visit, Weight max_weight) const {
+        using QueueItem = std::pair<Weight, VertexId>;
+        std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<QueueItem>> queue;
+        std::vector<VertexId> reached{ start };
+        weights[start] = ZERO_WEIGHT;
+        queue.push({ ZERO_WEIGHT, start });
+        while (!queue.empty()) {
+            const auto [weight, vertex] = queue.top();
+            queue.pop();
+            if (weights[vertex] < weight) {
+                continue;
+            }
+            visit(vertex, weight);
+            for (size_t i = offsets[vertex]; i < offsets[vertex + 1]; ++i) {
+                const Arc& arc = arcs[i];
+                const Weight candidate_weight = weight + arc.weight;
+                if (candidate_weight < weights[arc.to] && !(max_weight < candidate_weight)) {
+                    if (weights[arc.to] == UNREACHABLE) {
+                        reached.push_back(arc.to);
+                    }
+                    weights[arc.to] = candidate_weight;
+                    queue.push({ candidate_weight, arc.to });
+                }
+            }
+        }
+        for (const VertexId vertex : reached) {
+            weights[vertex] = UNREACHABLE;
+        }
+    }
+
+    // bucket many-to-many search: the backward search of every target leaves its weight in the buckets
+    // of the vertices it settles, then one forward search per source meets them all
+    template <typename Weight>
+    typename ContractionHierarchy<Weight>::WeightsTable ContractionHierarchy<Weight>::BuildWeights(
+        const std::vector<VertexId>& sources, const std::vector<VertexId>& targets) const {
+        struct BucketEntry {
+            size_t target;
+            Weight weight;
+        };
+        for (const std::vector<VertexId>* vertices : { &sources, &targets }) {
+            for (const VertexId vertex : *vertices) {
+                if (vertex >= vertex_count_) {
+                    throw std::out_of_range("Vertex is out of the contraction hierarchy");
+                }
+            }
+        }
+
+        std::vector<Weight> weights(vertex_count_, UNREACHABLE);
+        std::vector<std::vector<BucketEntry>> buckets(vertex_count_);
+        for (size_t j = 0; j < targets.size(); ++j) {
+            SearchUpward(targets[j], down_offsets_, down_arcs_, weights, [&](VertexId vertex, Weight weight) {
+                buckets[vertex].push_back({ j, weight });
+            });
+        }
+
+        WeightsTable table(sources.size(), std::vector<std::optional<Weight>>(targets.size()));
+        for (size_t i = 0; i < sources.size(); ++i) {
+            std::vector<std::optional<Weight>>& row = table[i];
+            SearchUpward(sources[i], up_offsets_, up_arcs_, weights, [&](VertexId vertex, Weight weight) {
+                for (const BucketEntry& entry : buckets[vertex]) {
+                    const Weight candidate_weight = weight + entry.weight;
+                    if (!row[entry.target] || candidate_weight < *row[entry.target]) {
+                        row[entry.target] = candidate_weight;
+                    }
+                }
+            });
+        }
+        return table;
+    }
+
+    template <typename Weight>
+    typename ContractionHierarchy<Weight>::ReachedVertices ContractionHierarchy<Weight>::BuildReachable(VertexId from,
+        size_t vertex_count, Weight max_weight) const {
+        if (from >= vertex_count_) {
+            throw std::out_of_range("Vertex is out of the contraction hierarchy");
+        }
+        if (max_weight < ZERO_WEIGHT) {
+            return {};
+        }
+        std::vector<Weight> search_weights(vertex_count_, UNREACHABLE);
+        std::vector<Weight> weights(vertex_count_, UNREACHABLE);
+        SearchUpward(from, up_offsets_, up_arcs_, search_weights, [&weights](VertexId vertex, Weight weight) {
+            weights[vertex] = weight;
+        }, max_weight);
+        // the arcs down to a vertex come from higher ones, whose weights are final by then
+        for (const VertexId vertex : sweep_order_) {
+            for (size_t i = down_offsets_[vertex]; i < down_offsets_[vertex + 1]; ++i) {
+                const Arc& arc = down_arcs_[i];
+                if (weights[arc.to] == UNREACHABLE || max_weight - weights[arc.to] < arc.weight) {
+                    continue;
+                }
+                weights[vertex] = std::min(weights[vertex], weights[arc.to] + arc.weight);
+            }
+        }
+        ReachedVertices reached;
+        for (VertexId vertex = 0; vertex < std::min(vertex_count, vertex_count_); ++vertex) {
+            if (weights[vertex] != UNREACHABLE) {
+                reached.push_back({ vertex, weights[vertex] });
+            }
+        }
+        return reached;
+    }
+}       // namespace graph
@@ -0,0 +1,193 @@
+#pragma once
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <queue>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "graph.h"
+#include "lru_cache.h"
+#include "router.h"
+
+namespace graph {
+    // answers every request with a one-to-all search from its source vertex,
+    // remembering the last computed source rows instead of a full V x V matrix
+    template <typename Weight>
+    class DijkstraRouter : public RouterInterface<Weight> {
+    private:        // names
+        using Graph = DirectedWeightedGraph<Weight>;
+
+        struct SourceRow {
+            std::vector<Weight> weights;
+            std::vector<EdgeId> prev_edges;
+        };
+
+    public:         // constructors
+        DijkstraRouter(const Graph& graph, size_t cache_capacity);
+
+    public:         // methods
+        using RouteInfo = typename RouterInterface<Weight>::RouteInfo;
+        std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const override;
+        using WeightsTable = typename RouterInterface<Weight>::WeightsTable;
+        WeightsTable BuildWeights(const std::vector<VertexId>& sources, const std::vector<VertexId>& targets) const override;
+        using ReachedVertices = typename RouterInterface<Weight>::ReachedVertices;
+        // a search of its own that goes no farther than max_weight, unless the row of the source is cached
+        ReachedVertices BuildReachable(VertexId from, size_t vertex_count, Weight max_weight) const override;
+
+        static size_t EstimateRowMemory(size_t vertex_count);
+
+    private:
+        std::shared_ptr<const SourceRow> GetSourceRow(VertexId from) const;
+        SourceRow ComputeSourceRow(VertexId from) const;
+        static constexpr Weight ZERO_WEIGHT{};
+        using RouterInterface<Weight>::UNREACHABLE;
+        static constexpr EdgeId NO_EDGE = std::numeric_limits<EdgeId>::max();
+        const Graph& graph_;
+        // the queries only share the cached rows, so they can run concurrently
+        mutable cache::LruCache<VertexId, SourceRow> rows_cache_;
+    };
+
+    template <typename Weight>
+    DijkstraRouter<Weight>::DijkstraRouter(const Graph& graph, size_t cache_capacity)
+        : graph_(graph)
+        , rows_cache_(cache_capacity, true)
+    {
+        for (EdgeId edge_id = 0; edge_id < graph.GetEdgeCount(); ++edge_id) {
+            if (graph.GetEdge(edge_id).weight < ZERO_WEIGHT) {
+                throw std::domain_error("Edges' weights should be non-negative");
+            }
+        }
+    }
+
+    template <typename Weight>
+    size_t DijkstraRouter<Weight>::EstimateRowMemory(size_t vertex_count) {
+        return vertex_count * (sizeof(Weight) + sizeof(EdgeId)) + sizeof(SourceRow);
+    }
+
+    template <typename Weight>
+    std::shared_ptr<const typename DijkstraRouter<Weight>::SourceRow> DijkstraRouter<Weight>::GetSourceRow(VertexId from) const {
+        if (std::shared_ptr<const SourceRow> row = rows_cache_.Get(from)) {
+            return row;
+        }
+        return rows_cache_.Put(from, ComputeSourceRow(from));
+    }
+
+    template <typename Weight>
+    typename DijkstraRouter<Weight>::SourceRow DijkstraRouter<Weight>::ComputeSourceRow(VertexId from) const {
+        using QueueItem = std::pair<Weight, VertexId>;
+        const size_t vertex_count = graph_.GetVertexCount();
+        SourceRow row{ std::vector<Weight>(vertex_count, UNREACHABLE),
+                       std::vector<EdgeId>(vertex_count, NO_EDGE) };
+        std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<QueueItem>> queue;
+        row.weights.at(from) = ZERO_WEIGHT;
+        queue.push({ ZERO_WEIGHT, from });
+        while (!queue.empty()) {
+            const auto [weight, vertex] = queue.top();
+            queue.pop();
+            if (row.weights[vertex] < weight) {
+                continue;
+            }
+            for (const IncidentEdge<Weight>& edge : graph_.GetIncidentEdges(vertex)) {
+                const Weight candidate_weight = weight + edge.weight;
+                if (candidate_weight < row.weights[edge.to]) {
+                    row.weights[edge.to] = candidate_weight;
+                    row.prev_edges[edge.to] = edge.id;
+                    queue.push({ candidate_weight, edge.to });
+                }
+            }
+        }
+        return row;
+    }
+
+    template <typename Weight>
+    std::optional<typename DijkstraRouter<Weight>::RouteInfo> DijkstraRouter<Weight>::BuildRoute(VertexId from,
+        VertexId to) const {
+        if (from == to) {
+            return RouteInfo{ ZERO_WEIGHT, {} };
+        }
+        const std::shared_ptr<const SourceRow> row = GetSourceRow(from);
+        if (!(row->weights.at(to) < UNREACHABLE)) {
+            return std::nullopt;
+        }
+        std::vector<EdgeId> edges;
+        for (EdgeId edge_id = row->prev_edges[to]; edge_id != NO_EDGE;
+            edge_id = row->prev_edges[graph_.GetEdge(edge_id).from])
+        {
+            edges.push_back(edge_id);
+        }
+        std::reverse(edges.begin(), edges.end());
+
+        return RouteInfo{ row->weights[to], std::move(edges) };
+    }
+
+    template <typename Weight>
+    typename DijkstraRouter<Weight>::WeightsTable DijkstraRouter<Weight>::BuildWeights(const std::vector<VertexId>& sources,
+        const std::vector<VertexId>& targets) const {
+        // one search per source answers all of its targets
+        WeightsTable table(sources.size(), std::vector<std::optional<Weight>>(targets.size()));
+        for (size_t i = 0; i < sources.size(); ++i) {
+            const std::shared_ptr<const SourceRow> row = GetSourceRow(sources[i]);
+            for (size_t j = 0; j < targets.size(); ++j) {
+                const Weight weight = row->weights.at(targets[j]);
+                if (weight < UNREACHABLE) {
+                    table[i][j] = weight;
+                }
+            }
+        }
+        return table;
+    }
+
+    template <typename Weight>
+    typename DijkstraRouter<Weight>::ReachedVertices DijkstraRouter<Weight>::BuildReachable(VertexId from,
+        size_t vertex_count, Weight max_weight) const {
+        ReachedVertices reached;
+        auto add_reached = [&](VertexId vertex, Weight weight) {
+            if (vertex < vertex_count) {
+                reached.push_back({ vertex, weight });
+            }
+        };
+        if (std::shared_ptr<const SourceRow> row = rows_cache_.Get(from)) {
+            for (VertexId vertex = 0; vertex < row->weights.size(); ++vertex) {
+                if (row->weights[vertex] < UNREACHABLE && !(max_weight < row->weights[vertex])) {
+                    add_reached(vertex, row->weights[vertex]);
+                }
+            }
+            return reached;
+        }
+
+        using QueueItem = std::pair<Weight, VertexId>;
+        std::unordered_map<VertexId, Weight> weights;
+        std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<QueueItem>> queue;
+        if (from >= graph_.GetVertexCount()) {
+            throw std::out_of_range("Vertex is out of the graph");
+        }
+        weights[from] = ZERO_WEIGHT;
+        queue.push({ ZERO_WEIGHT, from });
+        while (!queue.empty()) {
+            const auto [weight, vertex] = queue.top();
+            queue.pop();
+            if (weights.at(vertex) < weight) {
+                continue;
+            }
+            add_reached(vertex, weight);
+            for (const IncidentEdge<Weight>& edge : graph_.GetIncidentEdges(vertex)) {
+                const Weight candidate_weight = weight + edge.weight;
+                if (max_weight < candidate_weight) {
+                    continue;
+                }
+                auto [it, inserted] = weights.emplace(edge.to, candidate_weight);
+                if (inserted || candidate_weight < it->second) {
+                    it->second = candidate_weight;
+                    queue.push({ candidate_weight, edge.to });
+                }
+            }
+        }
+        return reached;
+    }
+}       // namespace graph
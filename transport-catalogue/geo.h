@@ -1,6 +1,9 @@
 #pragma once
 
+#include <algorithm>
 #include <cmath>
+#include <cstdint>
+#include <utility>
 inline const double EPSILON = 1e-6;
 
 namespace tr_cat {
@@ -26,5 +29,35 @@ namespace tr_cat {
             return std::acos(std::sin(from.lat * dr) * std::sin(to.lat * dr)
                 + std::cos(from.lat * dr) * std::cos(to.lat * dr) * std::cos(std::abs(from.lng - to.lng) * dr)) * earth_rad;
         }
+
+        // the position of the point on the Hilbert curve through a 2^16 x 2^16 grid over the box [min, max]:
+        // the points near each other on the curve are near each other on the map
+        inline uint64_t ComputeHilbertIndex(Coordinates point, Coordinates min, Coordinates max) {
+            const uint32_t grid_size = 1u << 16;
+            auto to_cell = [grid_size](double value, double min_value, double max_value) {
+                if (!(max_value > min_value)) {
+                    return 0u;
+                }
+                const double cell = std::round((value - min_value) / (max_value - min_value) * (grid_size - 1));
+                return static_cast<uint32_t>(std::clamp(cell, 0.0, double(grid_size - 1)));
+            };
+            uint32_t x = to_cell(point.lng, min.lng, max.lng);
+            uint32_t y = to_cell(point.lat, min.lat, max.lat);
+            uint64_t index = 0;
+            for (uint32_t quadrant_size = grid_size / 2; quadrant_size > 0; quadrant_size /= 2) {
+                const uint32_t right = (x & quadrant_size) > 0 ? 1 : 0;
+                const uint32_t top = (y & quadrant_size) > 0 ? 1 : 0;
+                index += uint64_t(quadrant_size) * quadrant_size * ((3 * right) ^ top);
+                // the lower quadrants hold the curve turned, so the rest of the point is turned the same way
+                if (top == 0) {
+                    if (right == 1) {
+                        x = grid_size - 1 - x;
+                        y = grid_size - 1 - y;
+                    }
+                    std::swap(x, y);
+                }
+            }
+            return index;
+        }
     }       // namespace geo
 }           // namespace tr_cat
\ No newline at end of file
@@ -1,6 +1,8 @@
 #pragma once
 
+#include <cassert>
 #include <cstdlib>
+#include <stdexcept>
 #include <vector>
 
 #include <graph.pb.h>
@@ -19,15 +21,28 @@ namespace graph {
         Weight weight;
     };
 
+    // an edge as stored next to the other edges leaving the same vertex
+    template <typename Weight>
+    struct IncidentEdge {
+        VertexId to;
+        Weight weight;
+        EdgeId id;
+    };
+
+    // edges are added first, then Finalize() packs them into a compressed sparse row layout:
+    // the edges leaving vertex v are incident_edges_[offsets_[v] .. offsets_[v + 1]),
+    // in the order they were added; adding an edge takes the graph out of the layout until the next Finalize()
     template <typename Weight>
     class DirectedWeightedGraph {
     private:        // names
-        using IncidenceList = std::vector<EdgeId>;
-        using IncidentEdgesRange = router::ranges::Range<typename IncidenceList::const_iterator>;
+        using IncidentEdgesRange = router::ranges::Range<const IncidentEdge<Weight>*>;
 
     private:        // fields
+        size_t vertex_count_ = 0;
         std::vector<Edge<Weight>> edges_;
-        std::vector<IncidenceList> incidence_lists_;
+        std::vector<size_t> offsets_;
+        std::vector<IncidentEdge<Weight>> incident_edges_;
+        bool finalized_ = false;
 
     public:         // constructors
         DirectedWeightedGraph() = default;
@@ -36,6 +51,9 @@ namespace graph {
         explicit DirectedWeightedGraph(size_t vertex_count);
         void SetVertexCount(size_t vertex_count);
         EdgeId AddEdge(const Edge<Weight>& edge);
+        void ReserveEdges(size_t edge_count) { edges_.reserve(edge_count); }
+        void Finalize();
+        bool IsFinalized() const { return finalized_; }
         
         size_t GetVertexCount() const;
         size_t GetEdgeCount() const;
@@ -47,24 +65,47 @@ namespace graph {
 
     template <typename Weight>
     DirectedWeightedGraph<Weight>::DirectedWeightedGraph(size_t vertex_count)
-        : incidence_lists_(vertex_count) { }
+        : vertex_count_(vertex_count) { }
     
     template <typename Weight>
     void DirectedWeightedGraph<Weight>::SetVertexCount(size_t vertex_count) {
-        incidence_lists_.resize(vertex_count);
+        if (finalized_) {
+            throw std::logic_error("Graph is finalized");
+        }
+        vertex_count_ = vertex_count;
     }
     
     template <typename Weight>
     EdgeId DirectedWeightedGraph<Weight>::AddEdge(const Edge<Weight>& edge) {
+        if (edge.from >= vertex_count_ || edge.to >= vertex_count_) {
+            throw std::out_of_range("Edge vertex is out of the graph");
+        }
         edges_.push_back(edge);
-        const EdgeId id = edges_.size() - 1;
-        incidence_lists_.at(edge.from).push_back(id);
-        return id;
+        finalized_ = false;
+        return edges_.size() - 1;
+    }
+
+    template <typename Weight>
+    void DirectedWeightedGraph<Weight>::Finalize() {
+        offsets_.assign(vertex_count_ + 1, 0);
+        for (const Edge<Weight>& edge : edges_) {
+            ++offsets_[edge.from + 1];
+        }
+        for (VertexId vertex = 0; vertex < vertex_count_; ++vertex) {
+            offsets_[vertex + 1] += offsets_[vertex];
+        }
+        incident_edges_.resize(edges_.size());
+        std::vector<size_t> positions(offsets_.begin(), offsets_.end() - 1);
+        for (EdgeId edge_id = 0; edge_id < edges_.size(); ++edge_id) {
+            const Edge<Weight>& edge = edges_[edge_id];
+            incident_edges_[positions[edge.from]++] = { edge.to, edge.weight, edge_id };
+        }
+        finalized_ = true;
     }
     
     template <typename Weight>
     size_t DirectedWeightedGraph<Weight>::GetVertexCount() const {
-        return incidence_lists_.size();
+        return vertex_count_;
     }
     
     template <typename Weight>
@@ -74,25 +115,30 @@ namespace graph {
     
     template <typename Weight>
     const Edge<Weight>& DirectedWeightedGraph<Weight>::GetEdge(EdgeId edge_id) const {
-        return edges_.at(edge_id);
+        assert(edge_id < edges_.size());
+        return edges_[edge_id];
     }
     
     template <typename Weight>
     typename DirectedWeightedGraph<Weight>::IncidentEdgesRange
     DirectedWeightedGraph<Weight>::GetIncidentEdges(VertexId vertex) const {
-        return router::ranges::AsRange(incidence_lists_.at(vertex));
+        assert(finalized_);
+        assert(vertex < vertex_count_);
+        const IncidentEdge<Weight>* data = incident_edges_.data();
+        return IncidentEdgesRange(data + offsets_[vertex], data + offsets_[vertex + 1]);
     }
 
     template<typename Weight>
     transport_catalog_serialize::Graph DirectedWeightedGraph<Weight>::GetSerializeData() const {
         transport_catalog_serialize::Graph graph;
-        for (const Edge<double>& edge : edges_) {
-            transport_catalog_serialize::Edge edge_out;
-            edge_out.set_from(static_cast<uint32_t>(edge.from));
-            edge_out.set_to(static_cast<uint32_t>(edge.to));
-            edge_out.set_weight(edge.weight);
-            graph.add_edges();
-            *graph.mutable_edges(graph.edges_size() - 1) = edge_out;
+        graph.set_vertex_count(static_cast<uint32_t>(GetVertexCount()));
+        graph.mutable_edge_from()->Reserve(static_cast<int>(edges_.size()));
+        graph.mutable_edge_to()->Reserve(static_cast<int>(edges_.size()));
+        graph.mutable_edge_weight()->Reserve(static_cast<int>(edges_.size()));
+        for (const Edge<Weight>& edge : edges_) {
+            graph.add_edge_from(static_cast<uint32_t>(edge.from));
+            graph.add_edge_to(static_cast<uint32_t>(edge.to));
+            graph.add_edge_weight(static_cast<double>(edge.weight));
         }
         return graph;
     }
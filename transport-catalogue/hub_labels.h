@@ -0,0 +1,467 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <numeric>
+#include <optional>
+#include <queue>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include <transport_router.pb.h>
+
+#include "graph.h"
+#include "router.h"
+
+namespace graph {
+    // 2-hop labels: every vertex keeps the hubs it reaches (forward label) and the hubs reaching it
+    // (backward label) with the route weights, so that some hub of every shortest route is in the forward
+    // label of its source and in the backward label of its target; a query merges the two sorted labels.
+    // The labels are built by pruned searches from the vertices in the order of their degree:
+    // a search does not go on from a vertex the labels built so far already give a route to
+    template <typename Weight>
+    class HubLabels : public RouterInterface<Weight> {
+    private:        // names
+        using Graph = DirectedWeightedGraph<Weight>;
+        using EdgeIndex = uint32_t;
+
+        // hub is the rank of the hub vertex, a label is sorted by it; edge is the first edge of the route
+        // to the hub in a forward label and the last edge of the route from the hub in a backward one
+        struct LabelEntry {
+            uint32_t hub;
+            Weight weight;
+            EdgeIndex edge;
+        };
+
+        // the label of a vertex is entries[offsets[vertex], offsets[vertex + 1])
+        struct LabelSet {
+            std::vector<size_t> offsets;
+            std::vector<LabelEntry> entries;
+        };
+
+        using LabelRange = router::ranges::Range<const LabelEntry*>;
+
+        // the edges of the graph turned around, in the compressed sparse row layout of the graph
+        struct ReversedGraph {
+            std::vector<size_t> offsets;
+            std::vector<IncidentEdge<Weight>> edges;
+        };
+
+        struct HubMatch {
+            Weight weight;
+            uint32_t hub;
+        };
+
+        // a vertex in the backward label of which a hub is
+        struct HubTarget {
+            VertexId vertex;
+            Weight weight;
+        };
+
+    public:         // constructors
+        explicit HubLabels(const Graph& graph);
+        HubLabels(const Graph& graph, const transport_catalog_serialize::HubLabelsData& data);
+
+    public:         // methods
+        using RouteInfo = typename RouterInterface<Weight>::RouteInfo;
+        std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const override;
+        using WeightsTable = typename RouterInterface<Weight>::WeightsTable;
+        WeightsTable BuildWeights(const std::vector<VertexId>& sources, const std::vector<VertexId>& targets) const override;
+        // every hub of the forward label of the source goes over the vertices it reaches, the nearest first,
+        // and stops at the first one farther than max_weight
+        using ReachedVertices = typename RouterInterface<Weight>::ReachedVertices;
+        ReachedVertices BuildReachable(VertexId from, size_t vertex_count, Weight max_weight) const override;
+
+        transport_catalog_serialize::HubLabelsData GetSerializeData() const;
+        size_t GetEntryCount() const { return forward_.entries.size() + backward_.entries.size(); }
+
+    private:        // preprocessing
+        static ReversedGraph BuildReversedGraph(const Graph& graph);
+        // the search from the hub of the rank along get_edges(vertex), the hub goes to the labels of the settled
+        // vertices unless their labels and the hub's opposite label already give a route as short
+        template <typename GetEdges>
+        void AddHub(uint32_t rank, GetEdges get_edges, const std::vector<LabelEntry>& hub_label,
+            std::vector<std::vector<LabelEntry>>& labels);
+        static LabelSet PackLabels(std::vector<std::vector<LabelEntry>>& labels);
+        void IndexHubTargets();
+
+    private:        // query
+        LabelRange GetLabel(const LabelSet& labels, VertexId vertex) const;
+        const LabelEntry& FindEntry(const LabelSet& labels, VertexId vertex, uint32_t hub) const;
+        std::optional<HubMatch> Match(VertexId from, VertexId to) const;
+        void CheckVertex(VertexId vertex) const;
+
+    private:        // fields
+        static constexpr Weight ZERO_WEIGHT{};
+        using RouterInterface<Weight>::UNREACHABLE;
+        static constexpr EdgeIndex NO_EDGE = std::numeric_limits<EdgeIndex>::max();
+
+        const Graph& graph_;
+        size_t vertex_count_;
+        std::vector<VertexId> order_;           // the vertices by rank
+        LabelSet forward_;
+        LabelSet backward_;
+        // the backward labels by hub rank: hub_targets_[hub_target_offsets_[hub], hub_target_offsets_[hub + 1]),
+        // sorted by weight
+        std::vector<size_t> hub_target_offsets_;
+        std::vector<HubTarget> hub_targets_;
+        // preprocessing only: the weights of the current hub's opposite label by hub rank
+        // and the search labels, UNREACHABLE between the searches
+        std::vector<Weight> hub_weights_;
+        std::vector<Weight> search_weights_;
+        std::vector<EdgeIndex> search_edges_;
+    };
+
+    template <typename Weight>
+    HubLabels<Weight>::HubLabels(const Graph& graph)
+        : graph_(graph)
+        , vertex_count_(graph.GetVertexCount())
+        , order_(graph.GetVertexCount())
+    {
+        if (graph.GetEdgeCount() >= NO_EDGE) {
+            throw std::length_error("Too many edges for the hub labels");
+        }
+        // the searches along the edges fill the backward labels, the ones against them the forward labels
+        const ReversedGraph reversed = BuildReversedGraph(graph);
+        auto get_edges = [&graph](VertexId vertex) {
+            return graph.GetIncidentEdges(vertex);
+        };
+        auto get_reversed_edges = [&reversed](VertexId vertex) {
+            const IncidentEdge<Weight>* data = reversed.edges.data();
+            return router::ranges::Range(data + reversed.offsets[vertex], data + reversed.offsets[vertex + 1]);
+        };
+
+        // the vertices with more edges lie on more routes, as early hubs they prune the later searches most
+        auto get_degree = [&](VertexId vertex) {
+            const auto edges = graph.GetIncidentEdges(vertex);
+            return static_cast<size_t>(edges.end() - edges.begin()) + reversed.offsets[vertex + 1] - reversed.offsets[vertex];
+        };
+        std::iota(order_.begin(), order_.end(), 0);
+        std::stable_sort(order_.begin(), order_.end(), [&](VertexId lhs, VertexId rhs) {
+            return get_degree(lhs) > get_degree(rhs);
+        });
+
+        std::vector<std::vector<LabelEntry>> forward(vertex_count_);
+        std::vector<std::vector<LabelEntry>> backward(vertex_count_);
+        hub_weights_.assign(vertex_count_, UNREACHABLE);
+        search_weights_.assign(vertex_count_, UNREACHABLE);
+        search_edges_.assign(vertex_count_, NO_EDGE);
+        for (uint32_t rank = 0; rank < vertex_count_; ++rank) {
+            AddHub(rank, get_edges, forward[order_[rank]], backward);
+            AddHub(rank, get_reversed_edges, backward[order_[rank]], forward);
+        }
+        hub_weights_ = {};
+        search_weights_ = {};
+        search_edges_ = {};
+        forward_ = PackLabels(forward);
+        backward_ = PackLabels(backward);
+        IndexHubTargets();
+    }
+
+    template <typename Weight>
+    HubLabels<Weight>::HubLabels(const Graph& graph, const transport_catalog_serialize::HubLabelsData& data)
+        : graph_(graph)
+        , vertex_count_(graph.GetVertexCount())
+        , order_(data.order().begin(), data.order().end())
+    {
+        auto read_labels = [&](const auto& offsets, const auto& hubs, const auto& weights, const auto& edges) {
+            if (static_cast<size_t>(offsets.size()) != vertex_count_ + 1 || hubs.size() != weights.size()
+                || hubs.size() != edges.size() || offsets[offsets.size() - 1] != static_cast<uint64_t>(hubs.size())) {
+                throw std::invalid_argument("Hub labels do not match the graph");
+            }
+            LabelSet labels{ std::vector<size_t>(offsets.begin(), offsets.end()), {} };
+            labels.entries.reserve(hubs.size());
+            for (int i = 0; i < hubs.size(); ++i) {
+                if (hubs[i] >= vertex_count_ || (edges[i] != NO_EDGE && edges[i] >= graph_.GetEdgeCount())) {
+                    throw std::invalid_argument("Hub labels do not match the graph");
+                }
+                labels.entries.push_back({ hubs[i], static_cast<Weight>(weights[i]), edges[i] });
+            }
+            return labels;
+        };
+        if (order_.size() != vertex_count_) {
+            throw std::invalid_argument("Hub labels do not match the graph");
+        }
+        forward_ = read_labels(data.forward_offsets(), data.forward_hubs(), data.forward_weights(), data.forward_edges());
+        backward_ = read_labels(data.backward_offsets(), data.backward_hubs(), data.backward_weights(),
+            data.backward_edges());
+        IndexHubTargets();
+    }
+
+    template <typename Weight>
+    void HubLabels<Weight>::IndexHubTargets() {
+        hub_target_offsets_.assign(vertex_count_ + 1, 0);
+        for (const LabelEntry& entry : backward_.entries) {
+            ++hub_target_offsets_[entry.hub + 1];
+        }
+        std::partial_sum(hub_target_offsets_.begin(), hub_target_offsets_.end(), hub_target_offsets_.begin());
+        hub_targets_.resize(backward_.entries.size());
+        std::vector<size_t> positions(hub_target_offsets_.begin(), hub_target_offsets_.end() - 1);
+        for (VertexId vertex = 0; vertex < vertex_count_; ++vertex) {
+            for (const LabelEntry& entry : GetLabel(backward_, vertex)) {
+                hub_targets_[positions[entry.hub]++] = { vertex, entry.weight };
+            }
+        }
+        for (uint32_t hub = 0; hub < vertex_count_; ++hub) {
+            std::sort(hub_targets_.begin() + hub_target_offsets_[hub], hub_targets_.begin() + hub_target_offsets_[hub + 1],
+                [](const HubTarget& lhs, const HubTarget& rhs) {
+                    return lhs.weight < rhs.weight;
+                });
+        }
+    }
+
+    template <typename Weight>
+    typename HubLabels<Weight>::ReversedGraph HubLabels<Weight>::BuildReversedGraph(const Graph& graph) {
+        ReversedGraph reversed;
+        reversed.offsets.assign(graph.GetVertexCount() + 1, 0);
+        for (EdgeId edge_id = 0; edge_id < graph.GetEdgeCount(); ++edge_id) {
+            const Edge<Weight>& edge = graph.GetEdge(edge_id);
+            if (edge.weight < ZERO_WEIGHT) {
+                throw std::domain_error("Edges' weights should be non-negative");
+            }
+            ++reversed.offsets[edge.to + 1];
+        }
+        for (VertexId vertex = 0; vertex < graph.GetVertexCount(); ++vertex) {
+            reversed.offsets[vertex + 1] += reversed.offsets[vertex];
+        }
+        reversed.edges.resize(graph.GetEdgeCount());
+        std::vector<size_t> positions(reversed.offsets.begin(), reversed.offsets.end() - 1);
+        for (EdgeId edge_id = 0; edge_id < graph.GetEdgeCount(); ++edge_id) {
+            const Edge<Weight>& edge = graph.GetEdge(edge_id);
+            reversed.edges[positions[edge.to]++] = { edge.from, edge.weight, edge_id };
+        }
+        return reversed;
+    }
+
+    template <typename Weight>
+    template <typename GetEdges>
+    void HubLabels<Weight>::AddHub(uint32_t rank, GetEdges get_edges, const std::vector<LabelEntry>& hub_label,
+        std::vector<std::vector<LabelEntry>>& labels) {
+        using QueueItem = std::pair<Weight, VertexId>;
+        for (const LabelEntry& entry : hub_label) {
+            hub_weights_[entry.hub] = entry.weight;
+        }
+        // a route through an earlier hub is as short; written as a difference not to overflow integral weights
+        auto is_covered = [&](VertexId vertex, Weight weight) {
+            for (const LabelEntry& entry : labels[vertex]) {
+                if (!(weight < entry.weight) && !(weight - entry.weight < hub_weights_[entry.hub])) {
+                    return true;
+                }
+            }
+            return false;
+        };
+
+        const VertexId hub = order_[rank];
+        std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<QueueItem>> queue;
+        std::vector<VertexId> reached{ hub };
+        search_weights_[hub] = ZERO_WEIGHT;
+        queue.push({ ZERO_WEIGHT, hub });
+        while (!queue.empty()) {
+            const auto [weight, vertex] = queue.top();
+            queue.pop();
+            if (search_weights_[vertex] < weight || is_covered(vertex, weight)) {
+                continue;
+            }
+            labels[vertex].push_back({ rank, weight, search_edges_[vertex] });
+            for (const IncidentEdge<Weight>& edge : get_edges(vertex)) {
+                const Weight candidate_weight = weight + edge.weight;
+                if (candidate_weight < search_weights_[edge.to]) {
+                    if (search_weights_[edge.to] == UNREACHABLE) {
+                        reached.push_back(edge.to);
+                    }
+                    search_weights_[edge.to] = candidate_weight;
+                    search_edges_[edge.to] = static_cast<EdgeIndex>(edge.id);
+                    queue.push({ candidate_weight, edge.to });
+                }
+            }
+        }
+
+        for (const VertexId vertex : reached) {
+            search_weights_[vertex] = UNREACHABLE;
+            search_edges_[vertex] = NO_EDGE;
+        }
+        for (const LabelEntry& entry : hub_label) {
+            hub_weights_[entry.hub] = UNREACHABLE;
+        }
+    }
+
+    template <typename Weight>
+    typename HubLabels<Weight>::LabelSet HubLabels<Weight>::PackLabels(std::vector<std::vector<LabelEntry>>& labels) {
+        LabelSet result;
+        result.offsets.reserve(labels.size() + 1);
+        result.offsets.push_back(0);
+        for (const std::vector<LabelEntry>& label : labels) {
+            result.offsets.push_back(result.offsets.back() + label.size());
+        }
+        result.entries.reserve(result.offsets.back());
+        for (std::vector<LabelEntry>& label : labels) {
+            result.entries.insert(result.entries.end(), label.begin(), label.end());
+            label = {};
+        }
+        return result;
+    }
+
+    template <typename Weight>
+    transport_catalog_serialize::HubLabelsData HubLabels<Weight>::GetSerializeData() const {
+        transport_catalog_serialize::HubLabelsData data_out;
+        data_out.mutable_order()->Add(order_.begin(), order_.end());
+        auto write_labels = [](const LabelSet& labels, auto* offsets, auto* hubs, auto* weights, auto* edges) {
+            offsets->Add(labels.offsets.begin(), labels.offsets.end());
+            hubs->Reserve(static_cast<int>(labels.entries.size()));
+            weights->Reserve(static_cast<int>(labels.entries.size()));
+            edges->Reserve(static_cast<int>(labels.entries.size()));
+            for (const LabelEntry& entry : labels.entries) {
+                hubs->Add(entry.hub);
+                weights->Add(static_cast<double>(entry.weight));
+                edges->Add(entry.edge);
+            }
+        };
+        write_labels(forward_, data_out.mutable_forward_offsets(), data_out.mutable_forward_hubs(),
+            data_out.mutable_forward_weights(), data_out.mutable_forward_edges());
+        write_labels(backward_, data_out.mutable_backward_offsets(), data_out.mutable_backward_hubs(),
+            data_out.mutable_backward_weights(), data_out.mutable_backward_edges());
+        return data_out;
+    }
+
+    template <typename Weight>
+    typename HubLabels<Weight>::LabelRange HubLabels<Weight>::GetLabel(const LabelSet& labels, VertexId vertex) const {
+        const LabelEntry* data = labels.entries.data();
+        return LabelRange(data + labels.offsets[vertex], data + labels.offsets[vertex + 1]);
+    }
+
+    template <typename Weight>
+    const typename HubLabels<Weight>::LabelEntry& HubLabels<Weight>::FindEntry(const LabelSet& labels, VertexId vertex,
+        uint32_t hub) const {
+        const LabelRange label = GetLabel(labels, vertex);
+        const LabelEntry* entry = std::lower_bound(label.begin(), label.end(), hub,
+            [](const LabelEntry& lhs, uint32_t rhs) { return lhs.hub < rhs; });
+        if (entry == label.end() || entry->hub != hub || entry->edge == NO_EDGE) {
+            throw std::logic_error("Hub labels are broken");
+        }
+        return *entry;
+    }
+
+    template <typename Weight>
+    std::optional<typename HubLabels<Weight>::HubMatch> HubLabels<Weight>::Match(VertexId from, VertexId to) const {
+        const LabelRange forward = GetLabel(forward_, from);
+        const LabelRange backward = GetLabel(backward_, to);
+        std::optional<HubMatch> best;
+        for (auto lhs = forward.begin(), rhs = backward.begin(); lhs != forward.end() && rhs != backward.end(); ) {
+            if (lhs->hub < rhs->hub) {
+                ++lhs;
+            }
+            else if (rhs->hub < lhs->hub) {
+                ++rhs;
+            }
+            else {
+                const Weight weight = lhs->weight + rhs->weight;
+                if (!best || weight < best->weight) {
+                    best = HubMatch{ weight, lhs->hub };
+                }
+                ++lhs;
+                ++rhs;
+            }
+        }
+        return best;
+    }
+
+    template <typename Weight>
+    void HubLabels<Weight>::CheckVertex(VertexId vertex) const {
+        if (vertex >= vertex_count_) {
+            throw std::out_of_range("Vertex is out of the hub labels");
+        }
+    }
+
+    template <typename Weight>
+    std::optional<typename HubLabels<Weight>::RouteInfo> HubLabels<Weight>::BuildRoute(VertexId from, VertexId to) const {
+        CheckVertex(from);
+        CheckVertex(to);
+        if (from == to) {
+            return RouteInfo{ ZERO_WEIGHT, {} };
+        }
+        const std::optional<HubMatch> match = Match(from, to);
+        if (!match) {
+            return std::nullopt;
+        }
+
+        // the edges of the labels lead to the hub from both ends
+        const VertexId hub = order_[match->hub];
+        std::vector<EdgeId> edges;
+        for (VertexId vertex = from; vertex != hub; ) {
+            const EdgeIndex edge_id = FindEntry(forward_, vertex, match->hub).edge;
+            edges.push_back(edge_id);
+            vertex = graph_.GetEdge(edge_id).to;
+        }
+        const size_t hub_position = edges.size();
+        for (VertexId vertex = to; vertex != hub; ) {
+            const EdgeIndex edge_id = FindEntry(backward_, vertex, match->hub).edge;
+            edges.push_back(edge_id);
+            vertex = graph_.GetEdge(edge_id).from;
+        }
+        std::reverse(edges.begin() + hub_position, edges.end());
+        return RouteInfo{ match->weight, std::move(edges) };
+    }
+
+    template <typename Weight>
+    typename HubLabels<Weight>::WeightsTable HubLabels<Weight>::BuildWeights(const std::vector<VertexId>& sources,
+        const std::vector<VertexId>& targets) const {
+        for (const std::vector<VertexId>* vertices : { &sources, &targets }) {
+            for (const VertexId vertex : *vertices) {
+                CheckVertex(vertex);
+            }
+        }
+        WeightsTable table(sources.size(), std::vector<std::optional<Weight>>(targets.size()));
+        for (size_t i = 0; i < sources.size(); ++i) {
+            for (size_t j = 0; j < targets.size(); ++j) {
+                if (sources[i] == targets[j]) {
+                    table[i][j] = ZERO_WEIGHT;
+                }
+                else if (const std::optional<HubMatch> match = Match(sources[i], targets[j])) {
+                    table[i][j] = match->weight;
+                }
+            }
+        }
+        return table;
+    }
+
+    template <typename Weight>
+    typename HubLabels<Weight>::ReachedVertices HubLabels<Weight>::BuildReachable(VertexId from, size_t vertex_count,
+        Weight max_weight) const {
+        CheckVertex(from);
+        if (max_weight < ZERO_WEIGHT) {
+            return {};
+        }
+        std::vector<Weight> weights(vertex_count_, UNREACHABLE);
+        std::vector<VertexId> reached_vertices{ from };
+        weights[from] = ZERO_WEIGHT;
+        for (const LabelEntry& entry : GetLabel(forward_, from)) {
+            // the label is sorted by hub, a hub too far only skips its targets
+            if (max_weight < entry.weight) {
+                continue;
+            }
+            for (size_t i = hub_target_offsets_[entry.hub]; i < hub_target_offsets_[entry.hub + 1]; ++i) {
+                const HubTarget& target = hub_targets_[i];
+                // written as a difference not to overflow integral weights
+                if (max_weight - entry.weight < target.weight) {
+                    break;
+                }
+                const Weight weight = entry.weight + target.weight;
+                if (weight < weights[target.vertex]) {
+                    if (weights[target.vertex] == UNREACHABLE) {
+                        reached_vertices.push_back(target.vertex);
+                    }
+                    weights[target.vertex] = weight;
+                }
+            }
+        }
+        ReachedVertices reached;
+        for (const VertexId vertex : reached_vertices) {
+            if (vertex < vertex_count) {
+                reached.push_back({ vertex, weights[vertex] });
+            }
+        }
+        return reached;
+    }
+}       // namespace graph
@@ -132,7 +132,7 @@ namespace json {
         Node LoadNull(std::istream& input) {
             std::string s;
             char c;
-            for (int i = 0; input >> c && i < 4; ++i) {
+            for (int i = 0; i < 4 && input >> c; ++i) {
                 s += c;
             }
             if (s != "null"s) {
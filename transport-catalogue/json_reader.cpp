@@ -88,6 +88,33 @@ namespace tr_cat {
                                       type, "",
                                       element.at("from"s).AsString(),
                                       element.at("to"s).AsString()});
+                    if (element.count("profile"s)) {
+                        stats_.back().profile = element.at("profile"s).AsString();
+                    }
+                } 
+                else if (type == "Matrix"s) {
+                    Stat stat{element.at("id"s).AsInt(), type, "", "", ""};
+                    for (auto& stop : element.at("from"s).AsArray()) {
+                        stat.from_list.push_back(stop.AsString());
+                    }
+                    for (auto& stop : element.at("to"s).AsArray()) {
+                        stat.to_list.push_back(stop.AsString());
+                    }
+                    if (element.count("profile"s)) {
+                        stat.profile = element.at("profile"s).AsString();
+                    }
+                    stats_.push_back(std::move(stat));
+                } 
+                else if (type == "Isochrone"s) {
+                    Stat stat{element.at("id"s).AsInt(), type, "", element.at("from"s).AsString(), ""};
+                    stat.max_time = element.at("max_time"s).AsDouble();
+                    if (stat.max_time < 0) {
+                        throw std::invalid_argument("invalid Isochrone: max_time >= 0"s);
+                    }
+                    if (element.count("profile"s)) {
+                        stat.profile = element.at("profile"s).AsString();
+                    }
+                    stats_.push_back(std::move(stat));
                 } 
                 else {
                     throw std::invalid_argument("Unknown type"s);
@@ -166,8 +193,141 @@ namespace tr_cat {
             if (velocity < 0 || wait_time < 0 || velocity > 1000 || wait_time > 1000) {
                 throw std::invalid_argument("invalid routing_settings: 0 <= velocity, wait_time <= 1000"s);
             }
-            transport_router_.SetSettings({static_cast<uint32_t>(wait_time),
-                                           static_cast<uint32_t>(velocity)});
+            router::RoutingSettings routing;
+            routing.bus_wait_time = wait_time;
+            routing.bus_velocity = velocity;
+            if (settings.count("router"s)) {
+                const std::string& router_type = settings.at("router"s).AsString();
+                if (router_type == "auto"s) {
+                    routing.router_type = router::RouterType::AUTO;
+                }
+                else if (router_type == "matrix"s) {
+                    routing.router_type = router::RouterType::MATRIX;
+                }
+                else if (router_type == "dijkstra"s) {
+                    routing.router_type = router::RouterType::DIJKSTRA;
+                }
+                else if (router_type == "contraction_hierarchy"s) {
+                    routing.router_type = router::RouterType::CONTRACTION_HIERARCHY;
+                }
+                else if (router_type == "raptor"s) {
+                    routing.router_type = router::RouterType::RAPTOR;
+                }
+                else if (router_type == "hub_labels"s) {
+                    routing.router_type = router::RouterType::HUB_LABELS;
+                }
+                else {
+                    throw std::invalid_argument("invalid routing_settings: unknown router "s + router_type);
+                }
+            }
+            if (settings.count("router_memory_limit_mb"s)) {
+                int memory_limit = settings.at("router_memory_limit_mb"s).AsInt();
+                if (memory_limit <= 0) {
+                    throw std::invalid_argument("invalid routing_settings: router_memory_limit_mb > 0"s);
+                }
+                routing.router_memory_limit = static_cast<size_t>(memory_limit) << 20;
+            }
+            if (settings.count("routing_graph"s)) {
+                const std::string& graph_model = settings.at("routing_graph"s).AsString();
+                if (graph_model == "complete"s) {
+                    routing.graph_model = router::GraphModel::COMPLETE;
+                }
+                else if (graph_model == "linear"s) {
+                    routing.graph_model = router::GraphModel::LINEAR;
+                }
+                else {
+                    throw std::invalid_argument("invalid routing_settings: unknown routing_graph "s + graph_model);
+                }
+            }
+            if (settings.count("route_cache_size"s)) {
+                int route_cache_size = settings.at("route_cache_size"s).AsInt();
+                if (route_cache_size <= 0) {
+                    throw std::invalid_argument("invalid routing_settings: route_cache_size > 0"s);
+                }
+                routing.route_cache_size = static_cast<size_t>(route_cache_size);
+            }
+            if (settings.count("goal_direction"s)) {
+                const std::string& goal_direction = settings.at("goal_direction"s).AsString();
+                if (goal_direction == "none"s) {
+                    routing.goal_direction = router::GoalDirection::NONE;
+                }
+                else if (goal_direction == "geo"s) {
+                    routing.goal_direction = router::GoalDirection::GEO;
+                }
+                else if (goal_direction == "landmarks"s) {
+                    routing.goal_direction = router::GoalDirection::LANDMARKS;
+                }
+                else {
+                    throw std::invalid_argument("invalid routing_settings: unknown goal_direction "s + goal_direction);
+                }
+            }
+            if (settings.count("landmark_count"s)) {
+                int landmark_count = settings.at("landmark_count"s).AsInt();
+                if (landmark_count <= 0) {
+                    throw std::invalid_argument("invalid routing_settings: landmark_count > 0"s);
+                }
+                routing.landmark_count = static_cast<size_t>(landmark_count);
+            }
+            if (settings.count("route_weights"s)) {
+                const std::string& weight_type = settings.at("route_weights"s).AsString();
+                if (weight_type == "double"s) {
+                    routing.weight_type = router::WeightType::DOUBLE;
+                }
+                else if (weight_type == "ticks"s) {
+                    routing.weight_type = router::WeightType::TICKS;
+                }
+                else {
+                    throw std::invalid_argument("invalid routing_settings: unknown route_weights "s + weight_type);
+                }
+            }
+            if (settings.count("vertex_order"s)) {
+                const std::string& vertex_order = settings.at("vertex_order"s).AsString();
+                if (vertex_order == "catalogue"s) {
+                    routing.vertex_order = router::VertexOrder::CATALOGUE;
+                }
+                else if (vertex_order == "hilbert"s) {
+                    routing.vertex_order = router::VertexOrder::HILBERT;
+                }
+                else {
+                    throw std::invalid_argument("invalid routing_settings: unknown vertex_order "s + vertex_order);
+                }
+            }
+            if (settings.count("profiles"s)) {
+                // the json dictionary keeps the profiles sorted by name
+                for (auto& [name, profile_node] : settings.at("profiles"s).AsMap()) {
+                    auto& profile = profile_node.AsMap();
+                    router::RoutingProfile routing_profile{ name, wait_time, velocity };
+                    if (profile.count("bus_velocity"s)) {
+                        routing_profile.bus_velocity = profile.at("bus_velocity"s).AsInt();
+                    }
+                    if (profile.count("bus_wait_time"s)) {
+                        routing_profile.bus_wait_time = profile.at("bus_wait_time"s).AsInt();
+                    }
+                    if (name.empty() || routing_profile.bus_velocity <= 0 || routing_profile.bus_wait_time < 0
+                        || routing_profile.bus_velocity > 1000 || routing_profile.bus_wait_time > 1000) {
+                        throw std::invalid_argument("invalid routing_settings: profile "s + name
+                            + ": 0 < velocity <= 1000, 0 <= wait_time <= 1000"s);
+                    }
+                    routing.profiles.push_back(std::move(routing_profile));
+                }
+            }
+            if (settings.count("prune_parallel_edges"s)) {
+                routing.prune_parallel_edges = settings.at("prune_parallel_edges"s).AsBool();
+            }
+            if (settings.count("build_threads"s)) {
+                int build_threads = settings.at("build_threads"s).AsInt();
+                if (build_threads < 0) {
+                    throw std::invalid_argument("invalid routing_settings: build_threads >= 0"s);
+                }
+                routing.build_threads = static_cast<size_t>(build_threads);
+            }
+            transport_router_.SetSettings(std::move(routing));
+        }
+
+        void JsonReader::UpdateGraph() {
+            for (const BusInput& bus : buses_) {
+                transport_router_.AddBus(*GetCatalog().GetBusInfo(bus.name));
+            }
         }
 
         void JsonReader::PrepareToPrint() {
@@ -221,7 +381,7 @@ namespace tr_cat {
 
         json::Node JsonReader::CreateNode::operator() (RouteOutput& value) {
             std::optional<router::CompletedRoute> result = 
-                transport_router_.ComputeRoute(value.from->vertex_id, value.to->vertex_id);
+                transport_router_.GetProfile(value.profile).ComputeRoute(value.from, value.to);
             json::Builder builder;
             if (!result) {
                 return builder.StartDict().Key("request_id"s).Value(value.id)
@@ -243,6 +403,41 @@ namespace tr_cat {
             return builder.Build();
         }
 
+        json::Node JsonReader::CreateNode::operator() (MatrixOutput& value) {
+            std::vector<std::vector<std::optional<double>>> times = transport_router_.GetProfile(value.profile).ComputeTimes(value.from, value.to);
+            json::Builder builder;
+            builder.StartDict().Key("request_id"s).Value(value.id)
+                               .Key("times"s).StartArray();
+            for (const std::vector<std::optional<double>>& row : times) {
+                builder.StartArray();
+                for (const std::optional<double>& time : row) {
+                    if (time) {
+                        builder.Value(*time);
+                    }
+                    else {
+                        builder.Value(nullptr);
+                    }
+                }
+                builder.EndArray();
+            }
+            builder.EndArray().EndDict();
+            return builder.Build();
+        }
+
+        json::Node JsonReader::CreateNode::operator() (IsochroneOutput& value) {
+            const std::vector<std::pair<const Stop*, double>> stops =
+                transport_router_.GetProfile(value.profile).ComputeIsochrone(value.from, value.max_time);
+            json::Builder builder;
+            builder.StartDict().Key("request_id"s).Value(value.id)
+                               .Key("stops"s).StartArray();
+            for (const auto& [stop, time] : stops) {
+                builder.StartDict() .Key("stop_name"s).Value(stop->name)
+                                    .Key("time"s).Value(time).EndDict();
+            }
+            builder.EndArray().EndDict();
+            return builder.Build();
+        }
+
         bool NodeCompare(json::Node lhs, json::Node rhs) {
             if (lhs.IsArray() && rhs.IsArray()) {
                 for (size_t i = 0; i < lhs.AsArray().size(); ++i) {
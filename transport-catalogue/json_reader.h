@@ -34,6 +34,8 @@ namespace tr_cat {
                 json::Node operator() (BusOutput& value);
                 json::Node operator() (MapOutput& value);
                 json::Node operator() (RouteOutput& value);
+                json::Node operator() (MatrixOutput& value);
+                json::Node operator() (IsochroneOutput& value);
             private:
                 render::MapRenderer& renderer_;
                 router::TransportRouter& transport_router_;
@@ -70,7 +72,15 @@ namespace tr_cat {
             bool Serialize(bool with_graph = false) const override { return serializator_.Serialize(with_graph); }
             bool Deserialize(bool with_graph = false) override { return serializator_.Deserialize(with_graph); }
             void RenderMap(std::ostream& out = std::cout) override { renderer_.Render(out); }
+            bool HasRoutingProfile(std::string_view name) const override { return transport_router_.HasProfile(name); }
             void CreateGraph() override { transport_router_.CreateGraph(); }
+            void UpdateGraph() override;
+            void SetBuildThreads(size_t thread_count) { transport_router_.SetBuildThreads(thread_count); }
+            void SetRowRange(graph::RowRange rows) { transport_router_.SetRowRange(rows); }
+            void SetMatrixMemoryBudget(size_t bytes) { transport_router_.SetMatrixMemoryBudget(bytes); }
+            size_t GetPrunedEdgeCount() const { return transport_router_.GetPrunedEdgeCount(); }
+            size_t GetMatrixRebuildCount() const { return transport_router_.GetMatrixRebuildCount(); }
+            void MergeBases(const std::vector<std::filesystem::path>& parts) const { serializator_.Merge(parts); }
             void PrintAnswers() override;
             bool TestingFilesOutput(std::string filename_lhs, std::string filename_rhs) override;
 
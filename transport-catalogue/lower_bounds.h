@@ -0,0 +1,268 @@
+#pragma once
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include <transport_router.pb.h>
+
+#include "geo.h"
+#include "graph.h"
+#include "router.h"
+
+namespace graph {
+    // estimates the weight of the routes from a vertex to the target from below, which keeps A* exact
+    template <typename Weight>
+    class LowerBound {
+    public:         // constructors
+        virtual ~LowerBound() = default;
+
+    public:         // methods
+        // RouterInterface::UNREACHABLE if the target can not be reached from the vertex at all
+        virtual Weight Estimate(VertexId vertex, VertexId target) const = 0;
+    };
+
+    // straight line distance to the target times the least weight per meter among the edges:
+    // by the triangle inequality no route can be cheaper
+    template <typename Weight>
+    class GeoLowerBound : public LowerBound<Weight> {
+    public:         // constructors
+        GeoLowerBound(const DirectedWeightedGraph<Weight>& graph, std::vector<tr_cat::geo::Coordinates> coordinates);
+
+    public:         // methods
+        Weight Estimate(VertexId vertex, VertexId target) const override;
+        double GetScale() const { return scale_; }
+
+    private:
+        double GetDistance(VertexId from, VertexId to) const;
+        // ComputeDistance is not exact for close points, the bound is kept a bit lower
+        static constexpr double SCALE_MARGIN = 0.99;
+        std::vector<tr_cat::geo::Coordinates> coordinates_;
+        double scale_ = 0;
+    };
+
+    // ALT: the route weights from and to a few landmark vertices bound all the others,
+    // d(v, t) >= d(L, t) - d(L, v) and d(v, t) >= d(v, L) - d(t, L)
+    template <typename Weight>
+    class Landmarks : public LowerBound<Weight> {
+    private:        // names
+        using Graph = DirectedWeightedGraph<Weight>;
+
+        // the edges of the graph turned around, in the compressed sparse row layout of the graph
+        struct ReversedGraph {
+            std::vector<size_t> offsets;
+            std::vector<IncidentEdge<Weight>> edges;
+        };
+
+    public:         // constructors
+        Landmarks(const Graph& graph, size_t landmark_count);
+        Landmarks(const Graph& graph, const transport_catalog_serialize::LandmarksData& data);
+
+    public:         // methods
+        Weight Estimate(VertexId vertex, VertexId target) const override;
+        size_t GetLandmarkCount() const { return landmarks_.size(); }
+        transport_catalog_serialize::LandmarksData GetSerializeData() const;
+
+    private:
+        static ReversedGraph BuildReversedGraph(const Graph& graph);
+        // get_edges(vertex) gives the edges leaving the vertex
+        template <typename GetEdges>
+        static std::vector<Weight> ComputeWeights(size_t vertex_count, VertexId source, GetEdges get_edges);
+        static constexpr Weight ZERO_WEIGHT{};
+        static constexpr Weight UNREACHABLE = RouterInterface<Weight>::UNREACHABLE;
+        size_t vertex_count_;
+        std::vector<VertexId> landmarks_;
+        // vertex-major: [vertex * landmark count + i] is the weight from / to the landmark i
+        std::vector<Weight> weights_from_;
+        std::vector<Weight> weights_to_;
+    };
+
+    template <typename Weight>
+    GeoLowerBound<Weight>::GeoLowerBound(const DirectedWeightedGraph<Weight>& graph,
+        std::vector<tr_cat::geo::Coordinates> coordinates)
+        : coordinates_(std::move(coordinates))
+    {
+        if (coordinates_.size() != graph.GetVertexCount()) {
+            throw std::invalid_argument("Every vertex needs coordinates");
+        }
+        double scale = std::numeric_limits<double>::infinity();
+        for (EdgeId edge_id = 0; edge_id < graph.GetEdgeCount(); ++edge_id) {
+            const Edge<Weight>& edge = graph.GetEdge(edge_id);
+            const double distance = GetDistance(edge.from, edge.to);
+            if (distance > 0) {
+                scale = std::min(scale, static_cast<double>(edge.weight) / distance);
+            }
+        }
+        scale_ = scale == std::numeric_limits<double>::infinity() ? 0 : scale * SCALE_MARGIN;
+    }
+
+    template <typename Weight>
+    double GeoLowerBound<Weight>::GetDistance(VertexId from, VertexId to) const {
+        const double distance = tr_cat::geo::ComputeDistance(coordinates_[from], coordinates_[to]);
+        // acos of a rounded up cosine is NaN
+        return distance > 0 ? distance : 0;
+    }
+
+    template <typename Weight>
+    Weight GeoLowerBound<Weight>::Estimate(VertexId vertex, VertexId target) const {
+        return static_cast<Weight>(scale_ * GetDistance(vertex, target));
+    }
+
+    template <typename Weight>
+    Landmarks<Weight>::Landmarks(const Graph& graph, size_t landmark_count)
+        : vertex_count_(graph.GetVertexCount())
+    {
+        const ReversedGraph reversed = BuildReversedGraph(graph);
+        auto get_edges = [&graph](VertexId vertex) {
+            return graph.GetIncidentEdges(vertex);
+        };
+        auto get_reversed_edges = [&reversed](VertexId vertex) {
+            const IncidentEdge<Weight>* data = reversed.edges.data();
+            return router::ranges::Range(data + reversed.offsets[vertex], data + reversed.offsets[vertex + 1]);
+        };
+        // farthest first: the next landmark is the vertex farthest from the ones chosen,
+        // vertices not reached from them at all go first, isolated ones are never chosen
+        std::vector<Weight> nearest(vertex_count_, UNREACHABLE);
+        std::vector<std::vector<Weight>> weights_from;
+        std::vector<std::vector<Weight>> weights_to;
+        while (landmarks_.size() < landmark_count) {
+            VertexId landmark = vertex_count_;
+            for (VertexId vertex = 0; vertex < vertex_count_; ++vertex) {
+                const bool isolated = graph.GetIncidentEdges(vertex).begin() == graph.GetIncidentEdges(vertex).end()
+                    && reversed.offsets[vertex] == reversed.offsets[vertex + 1];
+                if (isolated || nearest[vertex] == ZERO_WEIGHT) {
+                    continue;
+                }
+                if (landmark == vertex_count_ || nearest[landmark] < nearest[vertex]) {
+                    landmark = vertex;
+                }
+            }
+            if (landmark == vertex_count_) {
+                break;
+            }
+            landmarks_.push_back(landmark);
+            weights_from.push_back(ComputeWeights(vertex_count_, landmark, get_edges));
+            weights_to.push_back(ComputeWeights(vertex_count_, landmark, get_reversed_edges));
+            for (VertexId vertex = 0; vertex < vertex_count_; ++vertex) {
+                nearest[vertex] = std::min(nearest[vertex], weights_from.back()[vertex]);
+            }
+        }
+
+        const size_t count = landmarks_.size();
+        weights_from_.resize(vertex_count_ * count);
+        weights_to_.resize(vertex_count_ * count);
+        for (VertexId vertex = 0; vertex < vertex_count_; ++vertex) {
+            for (size_t i = 0; i < count; ++i) {
+                weights_from_[vertex * count + i] = weights_from[i][vertex];
+                weights_to_[vertex * count + i] = weights_to[i][vertex];
+            }
+        }
+    }
+
+    template <typename Weight>
+    Landmarks<Weight>::Landmarks(const Graph& graph, const transport_catalog_serialize::LandmarksData& data)
+        : vertex_count_(graph.GetVertexCount())
+        , landmarks_(data.landmarks().begin(), data.landmarks().end())
+        , weights_from_(data.weights_from().begin(), data.weights_from().end())
+        , weights_to_(data.weights_to().begin(), data.weights_to().end())
+    {
+        if (weights_from_.size() != vertex_count_ * landmarks_.size()
+            || weights_to_.size() != vertex_count_ * landmarks_.size())
+        {
+            throw std::invalid_argument("Landmarks data does not match the graph");
+        }
+    }
+
+    template <typename Weight>
+    typename Landmarks<Weight>::ReversedGraph Landmarks<Weight>::BuildReversedGraph(const Graph& graph) {
+        ReversedGraph reversed;
+        reversed.offsets.assign(graph.GetVertexCount() + 1, 0);
+        for (EdgeId edge_id = 0; edge_id < graph.GetEdgeCount(); ++edge_id) {
+            const Edge<Weight>& edge = graph.GetEdge(edge_id);
+            if (edge.weight < ZERO_WEIGHT) {
+                throw std::domain_error("Edges' weights should be non-negative");
+            }
+            ++reversed.offsets[edge.to + 1];
+        }
+        for (VertexId vertex = 0; vertex < graph.GetVertexCount(); ++vertex) {
+            reversed.offsets[vertex + 1] += reversed.offsets[vertex];
+        }
+        reversed.edges.resize(graph.GetEdgeCount());
+        std::vector<size_t> positions(reversed.offsets.begin(), reversed.offsets.end() - 1);
+        for (EdgeId edge_id = 0; edge_id < graph.GetEdgeCount(); ++edge_id) {
+            const Edge<Weight>& edge = graph.GetEdge(edge_id);
+            reversed.edges[positions[edge.to]++] = { edge.from, edge.weight, edge_id };
+        }
+        return reversed;
+    }
+
+    template <typename Weight>
+    template <typename GetEdges>
+    std::vector<Weight> Landmarks<Weight>::ComputeWeights(size_t vertex_count, VertexId source, GetEdges get_edges) {
+        using QueueItem = std::pair<Weight, VertexId>;
+        std::vector<Weight> weights(vertex_count, UNREACHABLE);
+        std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<QueueItem>> queue;
+        weights[source] = ZERO_WEIGHT;
+        queue.push({ ZERO_WEIGHT, source });
+        while (!queue.empty()) {
+            const auto [weight, vertex] = queue.top();
+            queue.pop();
+            if (weights[vertex] < weight) {
+                continue;
+            }
+            for (const IncidentEdge<Weight>& edge : get_edges(vertex)) {
+                const Weight candidate_weight = weight + edge.weight;
+                if (candidate_weight < weights[edge.to]) {
+                    weights[edge.to] = candidate_weight;
+                    queue.push({ candidate_weight, edge.to });
+                }
+            }
+        }
+        return weights;
+    }
+
+    template <typename Weight>
+    Weight Landmarks<Weight>::Estimate(VertexId vertex, VertexId target) const {
+        const size_t count = landmarks_.size();
+        const Weight* from_vertex = weights_from_.data() + vertex * count;
+        const Weight* from_target = weights_from_.data() + target * count;
+        const Weight* to_vertex = weights_to_.data() + vertex * count;
+        const Weight* to_target = weights_to_.data() + target * count;
+        Weight result = ZERO_WEIGHT;
+        for (size_t i = 0; i < count; ++i) {
+            // the landmark reaches the vertex but not the target: neither does the vertex
+            if (from_vertex[i] != UNREACHABLE) {
+                if (from_target[i] == UNREACHABLE) {
+                    return UNREACHABLE;
+                }
+                if (from_target[i] > from_vertex[i]) {
+                    result = std::max(result, from_target[i] - from_vertex[i]);
+                }
+            }
+            // the target reaches the landmark but the vertex does not: it can not reach the target
+            if (to_target[i] != UNREACHABLE) {
+                if (to_vertex[i] == UNREACHABLE) {
+                    return UNREACHABLE;
+                }
+                if (to_vertex[i] > to_target[i]) {
+                    result = std::max(result, to_vertex[i] - to_target[i]);
+                }
+            }
+        }
+        return result;
+    }
+
+    template <typename Weight>
+    transport_catalog_serialize::LandmarksData Landmarks<Weight>::GetSerializeData() const {
+        transport_catalog_serialize::LandmarksData data_out;
+        for (const VertexId landmark : landmarks_) {
+            data_out.add_landmarks(static_cast<uint32_t>(landmark));
+        }
+        data_out.mutable_weights_from()->Add(weights_from_.begin(), weights_from_.end());
+        data_out.mutable_weights_to()->Add(weights_to_.begin(), weights_to_.end());
+        return data_out;
+    }
+}       // namespace graph
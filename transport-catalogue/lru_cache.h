@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstdlib>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+
+namespace cache {
+    // keeps at most capacity values, evicting the least recently used one;
+    // a thread safe cache serializes all the calls with a mutex
+    template <typename Key, typename Value, typename Hasher = std::hash<Key>>
+    class LruCache {
+    private:        // names
+        using Entry = std::pair<Key, std::shared_ptr<const Value>>;
+        using Entries = std::list<Entry>;
+        using Lock = std::unique_lock<std::mutex>;
+
+    private:        // fields
+        size_t capacity_;
+        bool thread_safe_;
+        mutable std::mutex mutex_;
+        Entries entries_;
+        std::unordered_map<Key, typename Entries::iterator, Hasher> index_;
+        size_t hit_count_ = 0;
+        size_t miss_count_ = 0;
+
+    public:         // constructors
+        explicit LruCache(size_t capacity, bool thread_safe = false)
+            : capacity_(capacity == 0 ? 1 : capacity)
+            , thread_safe_(thread_safe) { }
+
+    public:         // methods
+        std::shared_ptr<const Value> Get(const Key& key);
+        std::shared_ptr<const Value> Put(const Key& key, Value&& value);
+        size_t GetCapacity() const { return capacity_; }
+        size_t GetHitCount() const { Lock lock = Guard(); return hit_count_; }
+        size_t GetMissCount() const { Lock lock = Guard(); return miss_count_; }
+        size_t size() const { Lock lock = Guard(); return entries_.size(); }
+        bool empty() const { Lock lock = Guard(); return entries_.empty(); }
+        void clear();
+
+    private:        // methods
+        Lock Guard() const { return thread_safe_ ? Lock(mutex_) : Lock(); }
+    };
+
+    template <typename Key, typename Value, typename Hasher>
+    std::shared_ptr<const Value> LruCache<Key, Value, Hasher>::Get(const Key& key) {
+        Lock lock = Guard();
+        auto it = index_.find(key);
+        if (it == index_.end()) {
+            ++miss_count_;
+            return nullptr;
+        }
+        ++hit_count_;
+        entries_.splice(entries_.begin(), entries_, it->second);
+        return it->second->second;
+    }
+
+    template <typename Key, typename Value, typename Hasher>
+    std::shared_ptr<const Value> LruCache<Key, Value, Hasher>::Put(const Key& key, Value&& value) {
+        auto value_ptr = std::make_shared<const Value>(std::move(value));
+        Lock lock = Guard();
+        auto it = index_.find(key);
+        if (it != index_.end()) {
+            it->second->second = value_ptr;
+            entries_.splice(entries_.begin(), entries_, it->second);
+            return value_ptr;
+        }
+        if (entries_.size() == capacity_) {
+            index_.erase(entries_.back().first);
+            entries_.pop_back();
+        }
+        entries_.emplace_front(key, value_ptr);
+        index_[key] = entries_.begin();
+        return value_ptr;
+    }
+
+    template <typename Key, typename Value, typename Hasher>
+    void LruCache<Key, Value, Hasher>::clear() {
+        Lock lock = Guard();
+        index_.clear();
+        entries_.clear();
+        hit_count_ = 0;
+        miss_count_ = 0;
+    }
+}       // namespace cache
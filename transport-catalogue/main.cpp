@@ -3,23 +3,81 @@
 #include "json_reader.h"
 
 #include <cassert>
+#include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <vector>
 
 using namespace std;
 using namespace tr_cat;
 
 void PrintUsage(std::ostream& stream = std::cerr) {
-    stream << "Usage: transport_catalogue [make_base|process_requests]\n"sv;
+    stream << "Usage: transport_catalogue [make_base [--threads N] [--rows A:B] [--memory MB]|update_base|process_requests"sv
+           << "|merge_base PART...]\n"sv;
+}
+
+size_t ParseNumber(const std::string& text) {
+    size_t length = 0;
+    const size_t number = std::stoul(text, &length);
+    if (length != text.size()) {
+        throw std::invalid_argument("Not a number: "s + text);
+    }
+    return number;
+}
+
+// "A:B" - the rows from A to B, not including B
+graph::RowRange ParseRowRange(const std::string& text) {
+    const size_t colon = text.find(':');
+    if (colon == std::string::npos) {
+        throw std::invalid_argument("Not a row range: "s + text);
+    }
+    return { ParseNumber(text.substr(0, colon)), ParseNumber(text.substr(colon + 1)) };
 }
 
 int main(int argc, char* argv[]) {
-    if (argc != 2) {
+    if (argc < 2) {
         PrintUsage();
         return 1;
     }
 
     const std::string_view mode(argv[1]);
+    std::optional<size_t> build_threads;
+    std::optional<graph::RowRange> rows;
+    std::optional<size_t> memory_budget;
+    std::vector<std::filesystem::path> parts;
+    try {
+        if (mode == "merge_base"sv) {
+            parts.assign(argv + 2, argv + argc);
+            if (parts.empty()) {
+                throw std::invalid_argument("No parts to merge"s);
+            }
+        }
+        for (int i = 2; i < argc && mode != "merge_base"sv; i += 2) {
+            const std::string_view option(argv[i]);
+            if (mode != "make_base"sv || i + 1 == argc) {
+                throw std::invalid_argument("Unexpected argument"s);
+            }
+            if (option == "--threads"sv) {
+                build_threads = ParseNumber(argv[i + 1]);
+            }
+            else if (option == "--rows"sv) {
+                rows = ParseRowRange(argv[i + 1]);
+            }
+            else if (option == "--memory"sv) {
+                memory_budget = ParseNumber(argv[i + 1]) << 20;
+            }
+            else {
+                throw std::invalid_argument("Unknown option"s);
+            }
+        }
+    }
+    catch (const std::exception&) {
+        PrintUsage();
+        return 1;
+    }
 
     if (mode == "make_base"sv) {
         aggregations::TransportCatalogue catalog;
@@ -29,8 +87,41 @@ int main(int argc, char* argv[]) {
         reader.AddStops ();
         reader.AddDistances ();
         reader.AddBuses ();
+        if (build_threads) {
+            reader.SetBuildThreads(*build_threads);
+        }
+        if (rows) {
+            // the base gets only these rows of the routes matrix, merge_base puts the parts together
+            reader.SetRowRange(*rows);
+        }
+        if (memory_budget) {
+            // the routes matrix is computed by batches of rows of this size and written out right away
+            reader.SetMatrixMemoryBudget(*memory_budget);
+        }
         reader.CreateGraph();
         reader.Serialize (true);
+        if (reader.GetPrunedEdgeCount() > 0) {
+            std::cerr << "Pruned parallel edges: "sv << reader.GetPrunedEdgeCount() << '\n';
+        }
+    } else if (mode == "update_base"sv) {
+        // the base requests hold the stops and buses to add to the base
+        aggregations::TransportCatalogue catalog;
+        interface::JsonReader reader(catalog);
+        reader.ReadDocument ();
+        reader.ParseDocument ();
+        reader.Deserialize (true);
+        reader.AddStops ();
+        reader.AddDistances ();
+        reader.AddBuses ();
+        reader.UpdateGraph ();
+        reader.Serialize (true);
+        if (reader.GetPrunedEdgeCount() > 0) {
+            std::cerr << "Pruned parallel edges: "sv << reader.GetPrunedEdgeCount() << '\n';
+        }
+        if (reader.GetMatrixRebuildCount() > 0) {
+            // a bus joining two components changes the blocks of the matrix, which is computed again then
+            std::cerr << "Routes matrix rebuilt for buses joining components: "sv << reader.GetMatrixRebuildCount() << '\n';
+        }
     } else if (mode == "process_requests"sv) {
         aggregations::TransportCatalogue catalog;
         interface::JsonReader reader(catalog);
@@ -39,6 +130,13 @@ int main(int argc, char* argv[]) {
         reader.Deserialize (true);
         reader.GetAnswers ();
         reader.PrintAnswers ();
+    } else if (mode == "merge_base"sv) {
+        // the serialization settings name the merged base
+        aggregations::TransportCatalogue catalog;
+        interface::JsonReader reader(catalog);
+        reader.ReadDocument ();
+        reader.ParseDocument ();
+        reader.MergeBases (parts);
     } else {
         PrintUsage();
         return 1;
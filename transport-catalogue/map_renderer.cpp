@@ -69,7 +69,10 @@ namespace tr_cat {
             settings_to_out.set_stop_label_font_size(settings_.stop_label_font_size);
             settings_to_out.set_stop_label_offset_x(settings_.stop_label_offset.x);
             settings_to_out.set_stop_label_offset_y(settings_.stop_label_offset.y);
-            *settings_to_out.mutable_underlayer_color() = *visit(ColorGetter(), settings_.underlayer_color);
+            // no color is left unset
+            if (std::optional<transport_catalog_serialize::Color> color = visit(ColorGetter(), settings_.underlayer_color)) {
+                *settings_to_out.mutable_underlayer_color() = *color;
+            }
             settings_to_out.set_underlayer_width(settings_.underlayer_width);
 
             for (auto& color : settings_.color_palette) {
@@ -0,0 +1,62 @@
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define MAPPED_FILE_HAS_MMAP
+#endif
+
+#include "mapped_file.h"
+
+namespace io {
+    using namespace std::string_literals;
+
+    MappedFile::MappedFile(const std::filesystem::path& path) {
+        Map(path);
+        if (!mapped_) {
+            Read(path);
+        }
+    }
+
+    MappedFile::~MappedFile() {
+#ifdef MAPPED_FILE_HAS_MMAP
+        if (mapped_) {
+            munmap(const_cast<char*>(data_), size_);
+        }
+#endif
+    }
+
+    void MappedFile::Map([[maybe_unused]] const std::filesystem::path& path) {
+#ifdef MAPPED_FILE_HAS_MMAP
+        const int descriptor = open(path.c_str(), O_RDONLY);
+        if (descriptor < 0) {
+            return;
+        }
+        struct stat file_stat {};
+        if (fstat(descriptor, &file_stat) == 0 && file_stat.st_size > 0) {
+            void* address = mmap(nullptr, static_cast<size_t>(file_stat.st_size), PROT_READ, MAP_PRIVATE, descriptor, 0);
+            if (address != MAP_FAILED) {
+                data_ = static_cast<const char*>(address);
+                size_ = static_cast<size_t>(file_stat.st_size);
+                mapped_ = true;
+            }
+        }
+        close(descriptor);
+#endif
+    }
+
+    void MappedFile::Read(const std::filesystem::path& path) {
+        std::ifstream in(path, std::ios::binary);
+        if (!in) {
+            throw std::invalid_argument("Can not open "s + path.string());
+        }
+        buffer_.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        data_ = buffer_.data();
+        size_ = buffer_.size();
+    }
+}       // namespace io
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstdlib>
+#include <filesystem>
+#include <vector>
+
+namespace io {
+    // a whole file in memory, read only: mapped where the system can map files and read into a buffer otherwise
+    class MappedFile {
+    private:        // fields
+        const char* data_ = nullptr;
+        size_t size_ = 0;
+        bool mapped_ = false;
+        std::vector<char> buffer_;
+
+    public:         // constructors
+        explicit MappedFile(const std::filesystem::path& path);
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+        ~MappedFile();
+
+    public:         // methods
+        const char* data() const { return data_; }
+        size_t size() const { return size_; }
+        bool IsMapped() const { return mapped_; }
+
+    private:
+        void Map(const std::filesystem::path& path);
+        void Read(const std::filesystem::path& path);
+    };
+}       // namespace io
@@ -0,0 +1,227 @@
+#include <limits>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define MIN_PLUS_HAS_X86
+#endif
+
+#include "min_plus.h"
+
+namespace graph {
+    namespace min_plus {
+        namespace {
+            enum class InstructionSet {
+                SCALAR,
+                SSE41,
+                AVX2,
+            };
+
+            constexpr uint32_t UNREACHABLE = std::numeric_limits<uint32_t>::max();
+            constexpr uint32_t SATURATED = UNREACHABLE - 1;
+
+            InstructionSet DetectInstructionSet() {
+#ifdef MIN_PLUS_HAS_X86
+                __builtin_cpu_init();
+                if (__builtin_cpu_supports("avx2")) {
+                    return InstructionSet::AVX2;
+                }
+                if (__builtin_cpu_supports("sse4.1")) {
+                    return InstructionSet::SSE41;
+                }
+#endif
+                return InstructionSet::SCALAR;
+            }
+
+            InstructionSet GetDetectedInstructionSet() {
+                static const InstructionSet instruction_set = DetectInstructionSet();
+                return instruction_set;
+            }
+
+            void RelaxRowScalar(double* weights, uint32_t* prev_edges, double weight_from, uint32_t prev_edge_from,
+                                const double* weights_through, const uint32_t* prev_edges_through, size_t count, uint32_t no_edge) {
+                for (size_t i = 0; i < count; ++i) {
+                    const double candidate = weight_from + weights_through[i];
+                    if (candidate < weights[i]) {
+                        weights[i] = candidate;
+                        prev_edges[i] = prev_edges_through[i] != no_edge ? prev_edges_through[i] : prev_edge_from;
+                    }
+                }
+            }
+
+            void RelaxRowScalar(uint32_t* weights, uint32_t* prev_edges, uint32_t weight_from, uint32_t prev_edge_from,
+                                const uint32_t* weights_through, const uint32_t* prev_edges_through, size_t count, uint32_t no_edge) {
+                // min(weight_from + w, SATURATED) without an overflow is min(w, headroom) + weight_from
+                const uint32_t headroom = SATURATED - weight_from;
+                for (size_t i = 0; i < count; ++i) {
+                    if (weights_through[i] == UNREACHABLE) {
+                        continue;
+                    }
+                    const uint32_t candidate = weights_through[i] < headroom ? weight_from + weights_through[i] : SATURATED;
+                    if (candidate < weights[i]) {
+                        weights[i] = candidate;
+                        prev_edges[i] = prev_edges_through[i] != no_edge ? prev_edges_through[i] : prev_edge_from;
+                    }
+                }
+            }
+
+#ifdef MIN_PLUS_HAS_X86
+            // the prev edges of the through row with no_edge replaced by prev_edge_from
+            __attribute__((target("sse4.1")))
+            __m128i SelectPrevEdges(__m128i prev_edges_through, __m128i prev_edge_from, __m128i no_edge) {
+                return _mm_blendv_epi8(prev_edges_through, prev_edge_from, _mm_cmpeq_epi32(prev_edges_through, no_edge));
+            }
+
+            __attribute__((target("avx2")))
+            __m256i SelectPrevEdges(__m256i prev_edges_through, __m256i prev_edge_from, __m256i no_edge) {
+                return _mm256_blendv_epi8(prev_edges_through, prev_edge_from, _mm256_cmpeq_epi32(prev_edges_through, no_edge));
+            }
+
+            __attribute__((target("avx2")))
+            void RelaxRowAvx2(double* weights, uint32_t* prev_edges, double weight_from, uint32_t prev_edge_from,
+                              const double* weights_through, const uint32_t* prev_edges_through, size_t count, uint32_t no_edge) {
+                const __m256d from = _mm256_set1_pd(weight_from);
+                const __m128i prev_from = _mm_set1_epi32(static_cast<int>(prev_edge_from));
+                const __m128i none = _mm_set1_epi32(static_cast<int>(no_edge));
+                // the low halves of the 64-bit lane masks are the masks of the 32-bit prev edges
+                const __m256i low_halves = _mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6);
+                size_t i = 0;
+                for (; i + 4 <= count; i += 4) {
+                    const __m256d current = _mm256_loadu_pd(weights + i);
+                    const __m256d candidate = _mm256_add_pd(from, _mm256_loadu_pd(weights_through + i));
+                    const __m256d improved = _mm256_cmp_pd(candidate, current, _CMP_LT_OQ);
+                    if (_mm256_movemask_pd(improved) == 0) {
+                        continue;
+                    }
+                    _mm256_storeu_pd(weights + i, _mm256_blendv_pd(current, candidate, improved));
+                    const __m128i mask = _mm256_castsi256_si128(
+                        _mm256_permutevar8x32_epi32(_mm256_castpd_si256(improved), low_halves));
+                    __m128i* prev = reinterpret_cast<__m128i*>(prev_edges + i);
+                    const __m128i through = SelectPrevEdges(
+                        _mm_loadu_si128(reinterpret_cast<const __m128i*>(prev_edges_through + i)), prev_from, none);
+                    _mm_storeu_si128(prev, _mm_blendv_epi8(_mm_loadu_si128(prev), through, mask));
+                }
+                RelaxRowScalar(weights + i, prev_edges + i, weight_from, prev_edge_from,
+                               weights_through + i, prev_edges_through + i, count - i, no_edge);
+            }
+
+            __attribute__((target("avx2")))
+            void RelaxRowAvx2(uint32_t* weights, uint32_t* prev_edges, uint32_t weight_from, uint32_t prev_edge_from,
+                              const uint32_t* weights_through, const uint32_t* prev_edges_through, size_t count, uint32_t no_edge) {
+                const __m256i from = _mm256_set1_epi32(static_cast<int>(weight_from));
+                const __m256i headroom = _mm256_set1_epi32(static_cast<int>(SATURATED - weight_from));
+                const __m256i unreachable = _mm256_set1_epi32(static_cast<int>(UNREACHABLE));
+                const __m256i prev_from = _mm256_set1_epi32(static_cast<int>(prev_edge_from));
+                const __m256i none = _mm256_set1_epi32(static_cast<int>(no_edge));
+                size_t i = 0;
+                for (; i + 8 <= count; i += 8) {
+                    const __m256i through_weights = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(weights_through + i));
+                    __m256i* current_weights = reinterpret_cast<__m256i*>(weights + i);
+                    const __m256i current = _mm256_loadu_si256(current_weights);
+                    const __m256i candidate = _mm256_add_epi32(_mm256_min_epu32(through_weights, headroom), from);
+                    // unsigned candidate >= current is max(candidate, current) == candidate
+                    const __m256i kept = _mm256_or_si256(
+                        _mm256_cmpeq_epi32(_mm256_max_epu32(candidate, current), candidate),
+                        _mm256_cmpeq_epi32(through_weights, unreachable));
+                    if (_mm256_movemask_epi8(kept) == -1) {
+                        continue;
+                    }
+                    _mm256_storeu_si256(current_weights, _mm256_blendv_epi8(candidate, current, kept));
+                    __m256i* prev = reinterpret_cast<__m256i*>(prev_edges + i);
+                    const __m256i through = SelectPrevEdges(
+                        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(prev_edges_through + i)), prev_from, none);
+                    _mm256_storeu_si256(prev, _mm256_blendv_epi8(through, _mm256_loadu_si256(prev), kept));
+                }
+                RelaxRowScalar(weights + i, prev_edges + i, weight_from, prev_edge_from,
+                               weights_through + i, prev_edges_through + i, count - i, no_edge);
+            }
+
+            __attribute__((target("sse4.1")))
+            void RelaxRowSse41(double* weights, uint32_t* prev_edges, double weight_from, uint32_t prev_edge_from,
+                               const double* weights_through, const uint32_t* prev_edges_through, size_t count, uint32_t no_edge) {
+                const __m128d from = _mm_set1_pd(weight_from);
+                const __m128i prev_from = _mm_set1_epi32(static_cast<int>(prev_edge_from));
+                const __m128i none = _mm_set1_epi32(static_cast<int>(no_edge));
+                size_t i = 0;
+                for (; i + 2 <= count; i += 2) {
+                    const __m128d current = _mm_loadu_pd(weights + i);
+                    const __m128d candidate = _mm_add_pd(from, _mm_loadu_pd(weights_through + i));
+                    const __m128d improved = _mm_cmplt_pd(candidate, current);
+                    if (_mm_movemask_pd(improved) == 0) {
+                        continue;
+                    }
+                    _mm_storeu_pd(weights + i, _mm_blendv_pd(current, candidate, improved));
+                    const __m128i mask = _mm_shuffle_epi32(_mm_castpd_si128(improved), _MM_SHUFFLE(3, 1, 2, 0));
+                    __m128i* prev = reinterpret_cast<__m128i*>(prev_edges + i);
+                    const __m128i through = SelectPrevEdges(
+                        _mm_loadl_epi64(reinterpret_cast<const __m128i*>(prev_edges_through + i)), prev_from, none);
+                    _mm_storel_epi64(prev, _mm_blendv_epi8(_mm_loadl_epi64(prev), through, mask));
+                }
+                RelaxRowScalar(weights + i, prev_edges + i, weight_from, prev_edge_from,
+                               weights_through + i, prev_edges_through + i, count - i, no_edge);
+            }
+
+            __attribute__((target("sse4.1")))
+            void RelaxRowSse41(uint32_t* weights, uint32_t* prev_edges, uint32_t weight_from, uint32_t prev_edge_from,
+                               const uint32_t* weights_through, const uint32_t* prev_edges_through, size_t count, uint32_t no_edge) {
+                const __m128i from = _mm_set1_epi32(static_cast<int>(weight_from));
+                const __m128i headroom = _mm_set1_epi32(static_cast<int>(SATURATED - weight_from));
+                const __m128i unreachable = _mm_set1_epi32(static_cast<int>(UNREACHABLE));
+                const __m128i prev_from = _mm_set1_epi32(static_cast<int>(prev_edge_from));
+                const __m128i none = _mm_set1_epi32(static_cast<int>(no_edge));
+                size_t i = 0;
+                for (; i + 4 <= count; i += 4) {
+                    const __m128i through_weights = _mm_loadu_si128(reinterpret_cast<const __m128i*>(weights_through + i));
+                    __m128i* current_weights = reinterpret_cast<__m128i*>(weights + i);
+                    const __m128i current = _mm_loadu_si128(current_weights);
+                    const __m128i candidate = _mm_add_epi32(_mm_min_epu32(through_weights, headroom), from);
+                    const __m128i kept = _mm_or_si128(
+                        _mm_cmpeq_epi32(_mm_max_epu32(candidate, current), candidate),
+                        _mm_cmpeq_epi32(through_weights, unreachable));
+                    if (_mm_movemask_epi8(kept) == 0xFFFF) {
+                        continue;
+                    }
+                    _mm_storeu_si128(current_weights, _mm_blendv_epi8(candidate, current, kept));
+                    __m128i* prev = reinterpret_cast<__m128i*>(prev_edges + i);
+                    const __m128i through = SelectPrevEdges(
+                        _mm_loadu_si128(reinterpret_cast<const __m128i*>(prev_edges_through + i)), prev_from, none);
+                    _mm_storeu_si128(prev, _mm_blendv_epi8(through, _mm_loadu_si128(prev), kept));
+                }
+                RelaxRowScalar(weights + i, prev_edges + i, weight_from, prev_edge_from,
+                               weights_through + i, prev_edges_through + i, count - i, no_edge);
+            }
+#endif
+        }
+
+        void RelaxRow(double* weights, uint32_t* prev_edges, double weight_from, uint32_t prev_edge_from,
+                      const double* weights_through, const uint32_t* prev_edges_through, size_t count, uint32_t no_edge) {
+            switch (GetDetectedInstructionSet()) {
+#ifdef MIN_PLUS_HAS_X86
+            case InstructionSet::AVX2:
+                RelaxRowAvx2(weights, prev_edges, weight_from, prev_edge_from, weights_through, prev_edges_through, count, no_edge);
+                break;
+            case InstructionSet::SSE41:
+                RelaxRowSse41(weights, prev_edges, weight_from, prev_edge_from, weights_through, prev_edges_through, count, no_edge);
+                break;
+#endif
+            default:
+                RelaxRowScalar(weights, prev_edges, weight_from, prev_edge_from, weights_through, prev_edges_through, count, no_edge);
+            }
+        }
+
+        void RelaxRow(uint32_t* weights, uint32_t* prev_edges, uint32_t weight_from, uint32_t prev_edge_from,
+                      const uint32_t* weights_through, const uint32_t* prev_edges_through, size_t count, uint32_t no_edge) {
+            switch (GetDetectedInstructionSet()) {
+#ifdef MIN_PLUS_HAS_X86
+            case InstructionSet::AVX2:
+                RelaxRowAvx2(weights, prev_edges, weight_from, prev_edge_from, weights_through, prev_edges_through, count, no_edge);
+                break;
+            case InstructionSet::SSE41:
+                RelaxRowSse41(weights, prev_edges, weight_from, prev_edge_from, weights_through, prev_edges_through, count, no_edge);
+                break;
+#endif
+            default:
+                RelaxRowScalar(weights, prev_edges, weight_from, prev_edge_from, weights_through, prev_edges_through, count, no_edge);
+            }
+        }
+    }   // namespace min_plus
+}       // namespace graph
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace graph {
+    namespace min_plus {
+        // relaxes a row of the routes matrix through a vertex: for every column where
+        // weight_from + weights_through[i] < weights[i] the sum is taken as the weight and
+        // prev_edges_through[i] (prev_edge_from if it is no_edge) as the last edge of the route;
+        // the vector kernel is chosen once by the features of the CPU, the results are the same for all
+        // +infinity means no route
+        void RelaxRow(double* weights, uint32_t* prev_edges, double weight_from, uint32_t prev_edge_from,
+                      const double* weights_through, const uint32_t* prev_edges_through, size_t count, uint32_t no_edge);
+        // max() means no route, the sums saturate at max() - 1
+        void RelaxRow(uint32_t* weights, uint32_t* prev_edges, uint32_t weight_from, uint32_t prev_edge_from,
+                      const uint32_t* weights_through, const uint32_t* prev_edges_through, size_t count, uint32_t no_edge);
+    }   // namespace min_plus
+}       // namespace graph
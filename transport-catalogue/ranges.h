@@ -1,5 +1,7 @@
 #pragma once
 
+#include <iterator>
+
 namespace router {
     namespace ranges {
         template <typename It>
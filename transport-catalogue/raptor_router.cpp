@@ -0,0 +1,145 @@
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+#include "raptor_router.h"
+
+namespace tr_cat {
+    namespace router {
+        RaptorRouter::RaptorRouter(const aggregations::TransportCatalogue& catalog, const std::vector<graph::VertexId>& stop_vertices,
+                                   size_t stop_count, double bus_wait_time, double bus_velocity)
+            : bus_wait_time_(bus_wait_time)
+            , stop_count_(stop_count)
+            , stop_routes_(stop_count)
+        {
+            for (std::string_view bus_name : catalog) {
+                const Bus* bus = *catalog.GetBusInfo(bus_name);
+                if (bus->stops.size() < 2) {
+                    continue;
+                }
+                Route route{ bus, {}, {} };
+                route.stops.reserve(bus->stops.size());
+                route.ride_times.reserve(bus->stops.size() - 1);
+                for (size_t i = 0; i < bus->stops.size(); ++i) {
+                    const graph::VertexId stop = stop_vertices.at(bus->stops[i]->vertex_id);
+                    route.stops.push_back(stop);
+                    stop_routes_.at(stop).push_back({ routes_.size(), i });
+                    if (i + 1 < bus->stops.size()) {
+                        route.ride_times.push_back(catalog.GetDistance(bus->stops[i], bus->stops[i + 1]) / bus_velocity);
+                    }
+                }
+                routes_.push_back(std::move(route));
+            }
+        }
+
+        RaptorRouter::SearchState RaptorRouter::Search(graph::VertexId from, std::optional<graph::VertexId> target) const {
+            if (from >= stop_count_ || (target && *target >= stop_count_)) {
+                throw std::out_of_range("Stop is out of the catalogue");
+            }
+            SearchState state;
+            state.rounds.emplace_back(stop_count_, UNREACHABLE);
+            state.labels.emplace_back(stop_count_);
+            state.rounds[0][from] = 0;
+            // the best time over all the rounds, a ride is only kept if it improves it here and at the target
+            std::vector<double> best(stop_count_, UNREACHABLE);
+            best[from] = 0;
+            std::vector<graph::VertexId> marked_stops{ from };
+            std::vector<size_t> first_positions(routes_.size(), NO_ROUTE);
+            std::vector<size_t> marked_routes;
+            std::vector<bool> improved(stop_count_, false);
+
+            while (!marked_stops.empty()) {
+                // every route is scanned once from its first stop improved in the last round
+                for (const graph::VertexId stop : marked_stops) {
+                    for (const RouteStop& route_stop : stop_routes_[stop]) {
+                        size_t& first_position = first_positions[route_stop.route];
+                        if (first_position == NO_ROUTE) {
+                            marked_routes.push_back(route_stop.route);
+                        }
+                        first_position = std::min(first_position, route_stop.position);
+                    }
+                }
+                const std::vector<double>& previous = state.rounds.back();
+                std::vector<double> current = previous;
+                std::vector<Label> labels(stop_count_);
+                marked_stops.clear();
+
+                for (const size_t route_index : marked_routes) {
+                    const Route& route = routes_[route_index];
+                    size_t board = NO_ROUTE;
+                    double board_time = 0;
+                    double ride_time = 0;
+                    for (size_t i = std::exchange(first_positions[route_index], NO_ROUTE); i < route.stops.size(); ++i) {
+                        const graph::VertexId stop = route.stops[i];
+                        if (board != NO_ROUTE) {
+                            ride_time += route.ride_times[i - 1];
+                            const double time = board_time + ride_time;
+                            const double bound = target ? std::min(best[stop], best[*target]) : best[stop];
+                            if (time < bound) {
+                                current[stop] = time;
+                                best[stop] = time;
+                                labels[stop] = { route_index, board, i, ride_time };
+                                if (!improved[stop]) {
+                                    improved[stop] = true;
+                                    marked_stops.push_back(stop);
+                                }
+                            }
+                        }
+                        // boarding here is better than staying on from an earlier stop
+                        if (previous[stop] != UNREACHABLE
+                            && (board == NO_ROUTE || previous[stop] + bus_wait_time_ < board_time + ride_time)) {
+                            board = i;
+                            board_time = previous[stop];
+                            ride_time = bus_wait_time_;
+                        }
+                    }
+                }
+                marked_routes.clear();
+                for (const graph::VertexId stop : marked_stops) {
+                    improved[stop] = false;
+                }
+                state.rounds.push_back(std::move(current));
+                state.labels.push_back(std::move(labels));
+            }
+            return state;
+        }
+
+        std::optional<RaptorRouter::Journey> RaptorRouter::FindJourney(graph::VertexId from, graph::VertexId to) const {
+            if (from == to) {
+                return Journey{ 0, {} };
+            }
+            const SearchState state = Search(from, to);
+            size_t round = state.rounds.size() - 1;
+            const double total_time = state.rounds[round][to];
+            if (total_time == UNREACHABLE) {
+                return std::nullopt;
+            }
+            // a time not improved in a round was carried over from the previous one
+            Journey journey{ total_time, {} };
+            for (graph::VertexId stop = to; stop != from; --round) {
+                while (state.labels[round][stop].route == NO_ROUTE) {
+                    --round;
+                }
+                const Label& label = state.labels[round][stop];
+                const Route& route = routes_[label.route];
+                journey.rides.push_back({ route.bus, label.board, label.alight, label.time });
+                stop = route.stops[label.board];
+            }
+            std::reverse(journey.rides.begin(), journey.rides.end());
+            return journey;
+        }
+
+        std::vector<std::optional<double>> RaptorRouter::ComputeTimes(graph::VertexId from,
+                                                                      const std::vector<graph::VertexId>& targets) const {
+            const SearchState state = Search(from, std::nullopt);
+            std::vector<std::optional<double>> result(targets.size());
+            for (size_t i = 0; i < targets.size(); ++i) {
+                const double time = state.rounds.back().at(targets[i]);
+                if (time != UNREACHABLE) {
+                    result[i] = time;
+                }
+            }
+            return result;
+        }
+    }   // namespace router
+}       // namespace tr_cat
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <limits>
+#include <optional>
+#include <vector>
+
+#include "domain.h"
+#include "router.h"
+#include "transport_catalogue.h"
+
+namespace tr_cat {
+    namespace router {
+        // round-based search on the stop sequences of the buses, without a graph or preprocessing:
+        // round k finds the best times over journeys of k bus rides, every round scans only the buses
+        // passing the stops improved by the previous one; a ride costs the wait plus the ride times
+        class RaptorRouter {
+        public:         // names
+            struct Ride {
+                const Bus* bus;
+                size_t board;           // positions in bus->stops
+                size_t alight;
+                double time;            // wait and ride
+            };
+
+            struct Journey {
+                double total_time;
+                std::vector<Ride> rides;
+            };
+
+        private:        // names
+            struct Route {
+                const Bus* bus;
+                std::vector<graph::VertexId> stops;
+                std::vector<double> ride_times;         // from the stop i to i + 1
+            };
+
+            struct RouteStop {
+                size_t route;
+                size_t position;
+            };
+
+            // how a stop was improved in a round: by the ride of the route from board to alight
+            struct Label {
+                size_t route = NO_ROUTE;
+                size_t board = 0;
+                size_t alight = 0;
+                double time = 0;
+            };
+
+            struct SearchState {
+                // rounds[k][stop] - the best time with at most k rides
+                std::vector<std::vector<double>> rounds;
+                std::vector<std::vector<Label>> labels;
+            };
+
+        public:         // constructors
+            // bus_velocity is in meters per minute; the stops are numbered by stop_vertices (by Stop::vertex_id)
+            // as in the routing graph, the stops no bus serves have no number
+            RaptorRouter(const aggregations::TransportCatalogue& catalog, const std::vector<graph::VertexId>& stop_vertices,
+                         size_t stop_count, double bus_wait_time, double bus_velocity);
+
+        public:         // methods
+            std::optional<Journey> FindJourney(graph::VertexId from, graph::VertexId to) const;
+            // times from the stop to all the targets, empty if there is no journey
+            std::vector<std::optional<double>> ComputeTimes(graph::VertexId from, const std::vector<graph::VertexId>& targets) const;
+
+        private:
+            SearchState Search(graph::VertexId from, std::optional<graph::VertexId> target) const;
+            static constexpr double UNREACHABLE = graph::RouterInterface<double>::UNREACHABLE;
+            static constexpr size_t NO_ROUTE = std::numeric_limits<size_t>::max();
+            double bus_wait_time_;
+            size_t stop_count_;
+            std::vector<Route> routes_;
+            // the routes passing each stop with the position of the stop in them
+            std::vector<std::vector<RouteStop>> stop_routes_;
+        };
+    }   // namespace router
+}       // namespace tr_cat
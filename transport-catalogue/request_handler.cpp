@@ -47,11 +47,39 @@ namespace tr_cat {
                 else if (stat.type == "Route"s) {
                     std::optional<const Stop*> from = catalog_.GetStopInfo(stat.from);
                     std::optional<const Stop*> to = catalog_.GetStopInfo(stat.to);
-                    if (!from || !to) {
+                    if (!from || !to || !HasRoutingProfile(stat.profile)) {
                         answers_.push_back(stat.id);
                         continue;
                     }
-                    answers_.push_back(RouteOutput({ stat.id, *from, *to }));
+                    answers_.push_back(RouteOutput({ stat.id, *from, *to, stat.profile }));
+                }
+                else if (stat.type == "Matrix"s) {
+                    MatrixOutput output{ stat.id, {}, {}, stat.profile };
+                    bool found = true;
+                    for (auto [names, stops] : { std::pair{ &stat.from_list, &output.from },
+                                                 std::pair{ &stat.to_list, &output.to } }) {
+                        for (std::string_view name : *names) {
+                            std::optional<const Stop*> stop = catalog_.GetStopInfo(name);
+                            if (!stop) {
+                                found = false;
+                                break;
+                            }
+                            stops->push_back(*stop);
+                        }
+                    }
+                    if (!found || !HasRoutingProfile(stat.profile)) {
+                        answers_.push_back(stat.id);
+                        continue;
+                    }
+                    answers_.push_back(std::move(output));
+                }
+                else if (stat.type == "Isochrone"s) {
+                    std::optional<const Stop*> from = catalog_.GetStopInfo(stat.from);
+                    if (!from || !HasRoutingProfile(stat.profile)) {
+                        answers_.push_back(stat.id);
+                        continue;
+                    }
+                    answers_.push_back(IsochroneOutput{ stat.id, *from, stat.max_time, stat.profile });
                 }
                 else {
                     throw std::invalid_argument("Invalid Stat"s);
@@ -35,7 +35,10 @@ namespace tr_cat {
             virtual void ParseDocument() = 0;
             virtual void PrintAnswers() = 0;
             virtual void CreateGraph() = 0;
+            virtual void UpdateGraph() = 0;
             virtual void RenderMap(std::ostream& out = std::cout) = 0;
+            // the requests for an unknown profile are answered as not found
+            virtual bool HasRoutingProfile(std::string_view name) const = 0;
 
             virtual bool TestingFilesOutput(std::string filename_lhs, std::string filename_rhs) = 0;
 
@@ -61,6 +64,10 @@ namespace tr_cat {
                 std::string_view name;
                 std::string_view from;
                 std::string_view to;
+                std::vector<std::string_view> from_list = {};
+                std::vector<std::string_view> to_list = {};
+                std::string_view profile = {};                  // routing profile, the default one if empty
+                double max_time = 0;
             };
             struct StopOutput {
                 int id;
@@ -80,6 +87,19 @@ namespace tr_cat {
                 int id;
                 const Stop* from;
                 const Stop* to;
+                std::string_view profile;
+            };
+            struct MatrixOutput {
+                int id;
+                std::vector<const Stop*> from;
+                std::vector<const Stop*> to;
+                std::string_view profile;
+            };
+            struct IsochroneOutput {
+                int id;
+                const Stop* from;
+                double max_time;
+                std::string_view profile;
             };
 
             // containers
@@ -87,7 +107,7 @@ namespace tr_cat {
             std::vector<BusInput> buses_;
             std::unordered_map<std::string_view, std::vector<std::pair<std::string_view, int>>> distances_;
             std::vector<Stat> stats_;
-            std::vector<std::variant<int, StopOutput, BusOutput, MapOutput, RouteOutput>> answers_;
+            std::vector<std::variant<int, StopOutput, BusOutput, MapOutput, RouteOutput, MatrixOutput, IsochroneOutput>> answers_;
             std::istream& input_ = std::cin;
             std::ostream& output_ = std::cout;
         };
@@ -3,184 +3,517 @@
 #include <algorithm>
 #include <cassert>
 #include <cstdint>
+#include <functional>
 #include <iterator>
+#include <limits>
+#include <memory>
 #include <optional>
+#include <queue>
 #include <stdexcept>
+#include <type_traits>
 #include <unordered_map>
 #include <utility>
 #include <vector>
 #include <transport_router.pb.h>
 
 #include "graph.h"
+#include "min_plus.h"
+#include "thread_pool.h"
 
 namespace graph {
     template <typename Weight>
-    class Router {
-    private:        // names
-        struct RouteInternalData {
+    class RouterInterface {
+    public:         // names
+        struct RouteInfo {
             Weight weight;
-            std::optional<EdgeId> prev_edge;
+            std::vector<EdgeId> edges;
         };
-        using Graph = DirectedWeightedGraph<Weight>;
-        using RoutesInternalData = std::vector<std::vector<std::optional<RouteInternalData>>>;
+
+        // the weight of no route, the routers keep it for the vertices they do not reach
+        static constexpr Weight UNREACHABLE = std::numeric_limits<Weight>::has_infinity
+            ? std::numeric_limits<Weight>::infinity() : std::numeric_limits<Weight>::max();
 
     public:         // constructors
-        explicit Router(const Graph& graph);
-        Router(const Graph& graph, const transport_catalog_serialize::RoutesData& routes_data);
+        virtual ~RouterInterface() = default;
 
-        struct RouteInfo {
-            Weight weight;
-            std::vector<EdgeId> edges;
+    public:         // methods
+        virtual std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const = 0;
+
+        // weights of the routes from every source to every target (table[source][target]),
+        // empty if there is no route; the default one builds every route separately
+        using WeightsTable = std::vector<std::vector<std::optional<Weight>>>;
+        virtual WeightsTable BuildWeights(const std::vector<VertexId>& sources, const std::vector<VertexId>& targets) const;
+
+        // the vertices reachable from the source by routes of at most max_weight with their weights,
+        // in no particular order; only the vertices below vertex_count are looked at, the default one
+        // takes the weights to all of them
+        using ReachedVertices = std::vector<std::pair<VertexId, Weight>>;
+        virtual ReachedVertices BuildReachable(VertexId from, size_t vertex_count, Weight max_weight) const;
+    };
+
+    template <typename Weight>
+    typename RouterInterface<Weight>::WeightsTable RouterInterface<Weight>::BuildWeights(
+        const std::vector<VertexId>& sources, const std::vector<VertexId>& targets) const {
+        WeightsTable table(sources.size(), std::vector<std::optional<Weight>>(targets.size()));
+        for (size_t i = 0; i < sources.size(); ++i) {
+            for (size_t j = 0; j < targets.size(); ++j) {
+                if (std::optional<RouteInfo> route = BuildRoute(sources[i], targets[j])) {
+                    table[i][j] = route->weight;
+                }
+            }
+        }
+        return table;
+    }
+
+    template <typename Weight>
+    typename RouterInterface<Weight>::ReachedVertices RouterInterface<Weight>::BuildReachable(VertexId from,
+        size_t vertex_count, Weight max_weight) const {
+        std::vector<VertexId> targets(vertex_count);
+        for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+            targets[vertex] = vertex;
+        }
+        const WeightsTable weights = BuildWeights({ from }, targets);
+        ReachedVertices reached;
+        for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+            if (weights.front()[vertex] && !(max_weight < *weights.front()[vertex])) {
+                reached.push_back({ vertex, *weights.front()[vertex] });
+            }
+        }
+        return reached;
+    }
+
+    // the rows [begin, end) of a routes matrix
+    struct RowRange {
+        VertexId begin;
+        VertexId end;
+    };
+
+    template <typename Weight>
+    class Router : public RouterInterface<Weight> {
+    private:        // names
+        using Graph = DirectedWeightedGraph<Weight>;
+
+    public:         // names
+        using PrevEdge = uint32_t;
+
+        // routes matrices owned by someone else, e.g. mapped from a file; storage keeps them alive
+        struct RoutesView {
+            size_t vertex_count;
+            const Weight* weights;
+            const PrevEdge* prev_edges;
+            std::shared_ptr<const void> storage;
         };
-        std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const;
 
-        transport_catalog_serialize::RoutesData GetSerializeData() const;
+    public:         // constructors
+        // with a thread pool the routes matrix is computed on all of its threads
+        explicit Router(const Graph& graph, concurrency::ThreadPool* pool = nullptr);
+        // uses the matrices in place, they are only copied if the routes are updated
+        Router(const Graph& graph, RoutesView routes_view);
+        // only the rows of the sources in the range, each by a one-to-all search, so that parts of
+        // the matrix can be computed apart and put together; only routes from them can be built
+        Router(const Graph& graph, RowRange rows, concurrency::ThreadPool* pool = nullptr);
+
+        using RouteInfo = typename RouterInterface<Weight>::RouteInfo;
+        std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const override;
+        using WeightsTable = typename RouterInterface<Weight>::WeightsTable;
+        WeightsTable BuildWeights(const std::vector<VertexId>& sources, const std::vector<VertexId>& targets) const override;
+        using ReachedVertices = typename RouterInterface<Weight>::ReachedVertices;
+        // a scan of the row of the source
+        ReachedVertices BuildReachable(VertexId from, size_t vertex_count, Weight max_weight) const override;
+
+        // updates the routes with the edges just added to the graph, the vertices must stay the same
+        void AddEdges(const std::vector<EdgeId>& edge_ids, concurrency::ThreadPool* pool = nullptr);
+
+        size_t GetVertexCount() const { return vertex_count_; }
+        RowRange GetRowRange() const { return { row_begin_, row_end_ }; }
+        const Weight* GetWeights() const { return weights_data_; }
+        const PrevEdge* GetPrevEdges() const { return prev_edges_data_; }
+        static size_t EstimateMemory(size_t vertex_count);
 
     private:
         void InitializeRoutesInternalData(const Graph& graph);
-        void RelaxRoute(VertexId vertex_from, VertexId vertex_to, const RouteInternalData& route_from, const RouteInternalData& route_to);
-        void RelaxRoutesInternalDataThroughVertex(size_t vertex_count, VertexId vertex_through);
-        RoutesInternalData SetDeserializeData(const transport_catalog_serialize::RoutesData& data) const;
+        void ComputeRoutesInternalData(concurrency::ThreadPool* pool);
+        void RelaxBlock(size_t row_block, size_t column_block, size_t through_block);
+        void RelaxRow(VertexId vertex_from, VertexId vertex_through, VertexId column_begin, VertexId column_end);
+        void RelaxRowThroughEdge(VertexId vertex_from, EdgeId edge_id, const std::vector<VertexId>& columns);
+        void ComputeRow(VertexId vertex_from);
+        void CheckSaturation() const;
+        static void CheckEdgeWeight(Weight weight);
+        void MakeOwned();
+        void UpdateDataPointers();
+        size_t GetIndex(VertexId from, VertexId to) const { return (from - row_begin_) * vertex_count_ + to; }
+        size_t GetCellCount() const { return (row_end_ - row_begin_) * vertex_count_; }
+        void CheckRow(VertexId from) const;
         static constexpr Weight ZERO_WEIGHT{};
+        using RouterInterface<Weight>::UNREACHABLE;
+        static constexpr PrevEdge NO_EDGE = std::numeric_limits<PrevEdge>::max();
+        // integral weights saturate at SATURATED instead of wrapping around, which keeps UNREACHABLE
+        // for no route and marks the routes too long for the weight type
+        static constexpr Weight SATURATED = std::is_integral_v<Weight> ? UNREACHABLE - 1 : UNREACHABLE;
+        static Weight AddWeights(Weight lhs, Weight rhs);
+        // a 64 x 64 block of weights and prev edges fits into L1 cache
+        static constexpr size_t BLOCK_SIZE = 64;
         const Graph& graph_;
-        RoutesInternalData routes_internal_data_;
+        size_t vertex_count_;
+        VertexId row_begin_ = 0;
+        VertexId row_end_ = 0;
+        // row-major (row_end_ - row_begin_) x vertex_count_ matrices: the route weight (UNREACHABLE
+        // if there is no route) and the last edge of the route (NO_EDGE for an empty route)
+        std::vector<Weight> weights_;
+        std::vector<PrevEdge> prev_edges_;
+        // the matrices the queries read: the vectors above or a view of the storage
+        const Weight* weights_data_ = nullptr;
+        const PrevEdge* prev_edges_data_ = nullptr;
+        std::shared_ptr<const void> storage_;
     };
 
     template <typename Weight>
     void Router<Weight>::InitializeRoutesInternalData(const Graph& graph) {
-        const size_t vertex_count = graph.GetVertexCount();
-        for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
-            routes_internal_data_[vertex][vertex] = RouteInternalData{ ZERO_WEIGHT, std::nullopt };
-            for (const EdgeId edge_id : graph.GetIncidentEdges(vertex)) {
-                const auto& edge = graph.GetEdge(edge_id);
-                if (edge.weight < ZERO_WEIGHT) {
-                    throw std::domain_error("Edges' weights should be non-negative");
-                }
-                auto& route_internal_data = routes_internal_data_[vertex][edge.to];
-                if (!route_internal_data || route_internal_data->weight > edge.weight) {
-                    route_internal_data = RouteInternalData{ edge.weight, edge_id };
+        if (graph.GetEdgeCount() >= NO_EDGE) {
+            throw std::length_error("Too many edges for the routes matrix");
+        }
+        for (VertexId vertex = 0; vertex < vertex_count_; ++vertex) {
+            weights_[GetIndex(vertex, vertex)] = ZERO_WEIGHT;
+            for (const IncidentEdge<Weight>& edge : graph.GetIncidentEdges(vertex)) {
+                CheckEdgeWeight(edge.weight);
+                const size_t index = GetIndex(vertex, edge.to);
+                if (weights_[index] > edge.weight) {
+                    weights_[index] = edge.weight;
+                    prev_edges_[index] = static_cast<PrevEdge>(edge.id);
                 }
             }
         }
     }
 
+    // blocked Floyd-Warshall: for every diagonal block the block itself is relaxed first,
+    // then the blocks of its row and column, then all remaining blocks; the blocks of
+    // the last two phases are independent of each other and are relaxed in parallel
     template <typename Weight>
-    void Router<Weight>::RelaxRoute(VertexId vertex_from, VertexId vertex_to, const RouteInternalData& route_from,
-        const RouteInternalData& route_to) {
-        auto& route_relaxing = routes_internal_data_[vertex_from][vertex_to];
-        const Weight candidate_weight = route_from.weight + route_to.weight;
-        if (!route_relaxing || candidate_weight < route_relaxing->weight) {
-            route_relaxing = { candidate_weight,
-                              route_to.prev_edge ? route_to.prev_edge : route_from.prev_edge };
+    void Router<Weight>::ComputeRoutesInternalData(concurrency::ThreadPool* pool) {
+        const size_t block_count = (vertex_count_ + BLOCK_SIZE - 1) / BLOCK_SIZE;
+        for (size_t through_block = 0; through_block < block_count; ++through_block) {
+            RelaxBlock(through_block, through_block, through_block);
+
+            concurrency::ParallelFor(pool, 2 * block_count, [&](size_t index) {
+                const size_t other_block = index / 2;
+                if (other_block == through_block) {
+                    return;
+                }
+                if (index % 2 == 0) {
+                    RelaxBlock(through_block, other_block, through_block);
+                }
+                else {
+                    RelaxBlock(other_block, through_block, through_block);
+                }
+            });
+
+            concurrency::ParallelFor(pool, block_count * block_count, [&](size_t index) {
+                const size_t row_block = index / block_count;
+                const size_t column_block = index % block_count;
+                if (row_block != through_block && column_block != through_block) {
+                    RelaxBlock(row_block, column_block, through_block);
+                }
+            });
         }
     }
 
     template <typename Weight>
-    void Router<Weight>::RelaxRoutesInternalDataThroughVertex(size_t vertex_count, VertexId vertex_through) {
-        for (VertexId vertex_from = 0; vertex_from < vertex_count; ++vertex_from) {
-            if (const auto& route_from = routes_internal_data_[vertex_from][vertex_through]) {
-                for (VertexId vertex_to = 0; vertex_to < vertex_count; ++vertex_to) {
-                    if (const auto& route_to = routes_internal_data_[vertex_through][vertex_to]) {
-                        RelaxRoute(vertex_from, vertex_to, *route_from, *route_to);
-                    }
-                }
+    void Router<Weight>::RelaxBlock(size_t row_block, size_t column_block, size_t through_block) {
+        const VertexId row_end = std::min(vertex_count_, (row_block + 1) * BLOCK_SIZE);
+        const VertexId column_begin = column_block * BLOCK_SIZE;
+        const VertexId column_end = std::min(vertex_count_, column_begin + BLOCK_SIZE);
+        const VertexId through_end = std::min(vertex_count_, (through_block + 1) * BLOCK_SIZE);
+        for (VertexId vertex_through = through_block * BLOCK_SIZE; vertex_through < through_end; ++vertex_through) {
+            for (VertexId vertex_from = row_block * BLOCK_SIZE; vertex_from < row_end; ++vertex_from) {
+                RelaxRow(vertex_from, vertex_through, column_begin, column_end);
             }
         }
     }
 
     template <typename Weight>
-    typename Router<Weight>::RoutesInternalData Router<Weight>::SetDeserializeData(const transport_catalog_serialize::RoutesData& data) const {
-        RoutesInternalData routes_internal_data;
-        routes_internal_data.reserve(data.data_size());
-        for (int i = 0; i < data.data_size(); ++i) {
-            const transport_catalog_serialize::ArrayRouteInternalData& array_in = data.data(i);
-            std::vector<std::optional<RouteInternalData>> array_to_write;
-            array_to_write.reserve(array_in.data_size());
-            for (int j = 0; j < array_in.data_size(); ++j) {
-                if (array_in.data(j).has_value()) {
-                    const transport_catalog_serialize::RouteInternalData& route_in = array_in.data(j);
-                    std::optional<EdgeId> prev_edge;
-                    if (route_in.prev_edge() == -1) {
-                        prev_edge = std::nullopt;
-                    }
-                    else {
-                        prev_edge = static_cast<EdgeId>(route_in.prev_edge());
-                    }
-                    array_to_write.push_back(RouteInternalData{ route_in.weight(), prev_edge });
+    void Router<Weight>::RelaxRow(VertexId vertex_from, VertexId vertex_through, VertexId column_begin,
+        VertexId column_end) {
+        Weight* weights_from = weights_.data() + GetIndex(vertex_from, 0);
+        const Weight weight_from = weights_from[vertex_through];
+        if (weight_from == UNREACHABLE) {
+            return;
+        }
+        PrevEdge* prev_edges_from = prev_edges_.data() + GetIndex(vertex_from, 0);
+        const PrevEdge prev_edge_from = prev_edges_from[vertex_through];
+        const Weight* weights_through = weights_.data() + GetIndex(vertex_through, 0);
+        const PrevEdge* prev_edges_through = prev_edges_.data() + GetIndex(vertex_through, 0);
+        if constexpr (std::is_same_v<Weight, double> || std::is_same_v<Weight, uint32_t>) {
+            min_plus::RelaxRow(weights_from + column_begin, prev_edges_from + column_begin, weight_from, prev_edge_from,
+                               weights_through + column_begin, prev_edges_through + column_begin,
+                               column_end - column_begin, NO_EDGE);
+            return;
+        }
+        for (VertexId vertex_to = column_begin; vertex_to < column_end; ++vertex_to) {
+            if (weights_through[vertex_to] == UNREACHABLE) {
+                continue;
+            }
+            const Weight candidate_weight = AddWeights(weight_from, weights_through[vertex_to]);
+            if (candidate_weight < weights_from[vertex_to]) {
+                weights_from[vertex_to] = candidate_weight;
+                prev_edges_from[vertex_to] = prev_edges_through[vertex_to] != NO_EDGE
+                    ? prev_edges_through[vertex_to] : prev_edge_from;
+            }
+        }
+    }
+
+    // a route can only improve by going through a new edge from -> to, so for every new edge only
+    // the rows reaching `to` cheaper through it and the columns reached cheaper from `from` are relaxed
+    template <typename Weight>
+    void Router<Weight>::AddEdges(const std::vector<EdgeId>& edge_ids, concurrency::ThreadPool* pool) {
+        if (graph_.GetVertexCount() != vertex_count_) {
+            throw std::logic_error("Vertices can not be added to the routes matrix");
+        }
+        if (row_begin_ != 0 || row_end_ != vertex_count_) {
+            throw std::logic_error("Edges can not be added to a part of the routes matrix");
+        }
+        if (graph_.GetEdgeCount() >= NO_EDGE) {
+            throw std::length_error("Too many edges for the routes matrix");
+        }
+        MakeOwned();
+        std::vector<VertexId> rows;
+        std::vector<VertexId> columns;
+        for (const EdgeId edge_id : edge_ids) {
+            const Edge<Weight>& edge = graph_.GetEdge(edge_id);
+            CheckEdgeWeight(edge.weight);
+            if (!(edge.weight < weights_[GetIndex(edge.from, edge.to)])) {
+                continue;
+            }
+            rows.clear();
+            columns.clear();
+            for (VertexId vertex = 0; vertex < vertex_count_; ++vertex) {
+                const Weight weight_to_edge = weights_[GetIndex(vertex, edge.from)];
+                if (weight_to_edge != UNREACHABLE && AddWeights(weight_to_edge, edge.weight) < weights_[GetIndex(vertex, edge.to)]) {
+                    rows.push_back(vertex);
                 }
-                else {
-                    array_to_write.push_back(std::nullopt);
+                const Weight weight_from_edge = weights_[GetIndex(edge.to, vertex)];
+                if (weight_from_edge != UNREACHABLE && AddWeights(edge.weight, weight_from_edge) < weights_[GetIndex(edge.from, vertex)]) {
+                    columns.push_back(vertex);
                 }
             }
-            routes_internal_data.push_back(move(array_to_write));
-        }
-        return routes_internal_data;
-    }
-
-    template <typename Weight>
-    transport_catalog_serialize::RoutesData Router<Weight>::GetSerializeData() const {
-        transport_catalog_serialize::RoutesData data_out;
-        for (const std::vector<std::optional<RouteInternalData>>& array_route_internal_data : routes_internal_data_) {
-            transport_catalog_serialize::ArrayRouteInternalData array_out;
-            for (const std::optional<RouteInternalData>& route : array_route_internal_data) {
-                transport_catalog_serialize::RouteInternalData route_out;
-                if (route) {
-                    route_out.set_weight(route->weight);
-                    if (route->prev_edge) {
-                        route_out.set_prev_edge(*route->prev_edge);
-                    }
-                    else {
-                        route_out.set_prev_edge(-1);
-                    }
-                    route_out.set_has_value(true);
-                }
-                else {
-                    route_out.set_has_value(false);
+            // neither the row of edge.to nor the column of edge.from is among them, so the rows are independent
+            concurrency::ParallelFor(pool, rows.size(), [&](size_t i) {
+                RelaxRowThroughEdge(rows[i], edge_id, columns);
+            });
+        }
+        CheckSaturation();
+    }
+
+    template <typename Weight>
+    void Router<Weight>::RelaxRowThroughEdge(VertexId vertex_from, EdgeId edge_id, const std::vector<VertexId>& columns) {
+        const Edge<Weight>& edge = graph_.GetEdge(edge_id);
+        Weight* weights_from = weights_.data() + GetIndex(vertex_from, 0);
+        PrevEdge* prev_edges_from = prev_edges_.data() + GetIndex(vertex_from, 0);
+        const Weight weight_through_edge = AddWeights(weights_from[edge.from], edge.weight);
+        const Weight* weights_through = weights_.data() + GetIndex(edge.to, 0);
+        const PrevEdge* prev_edges_through = prev_edges_.data() + GetIndex(edge.to, 0);
+        for (const VertexId vertex_to : columns) {
+            const Weight candidate_weight = AddWeights(weight_through_edge, weights_through[vertex_to]);
+            if (candidate_weight < weights_from[vertex_to]) {
+                weights_from[vertex_to] = candidate_weight;
+                prev_edges_from[vertex_to] = prev_edges_through[vertex_to] != NO_EDGE
+                    ? prev_edges_through[vertex_to] : static_cast<PrevEdge>(edge_id);
+            }
+        }
+    }
+
+    template <typename Weight>
+    void Router<Weight>::ComputeRow(VertexId vertex_from) {
+        using QueueItem = std::pair<Weight, VertexId>;
+        Weight* weights_from = weights_.data() + GetIndex(vertex_from, 0);
+        PrevEdge* prev_edges_from = prev_edges_.data() + GetIndex(vertex_from, 0);
+        std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<QueueItem>> queue;
+        weights_from[vertex_from] = ZERO_WEIGHT;
+        queue.push({ ZERO_WEIGHT, vertex_from });
+        while (!queue.empty()) {
+            const auto [weight, vertex] = queue.top();
+            queue.pop();
+            if (weights_from[vertex] < weight) {
+                continue;
+            }
+            for (const IncidentEdge<Weight>& edge : graph_.GetIncidentEdges(vertex)) {
+                const Weight candidate_weight = AddWeights(weight, edge.weight);
+                if (candidate_weight < weights_from[edge.to]) {
+                    weights_from[edge.to] = candidate_weight;
+                    prev_edges_from[edge.to] = static_cast<PrevEdge>(edge.id);
+                    queue.push({ candidate_weight, edge.to });
                 }
-                array_out.add_data();
-                *array_out.mutable_data(array_out.data_size() - 1) = std::move(route_out);
             }
-            data_out.add_data();
-            *data_out.mutable_data(data_out.data_size() - 1) = std::move(array_out);
         }
-        return data_out;
     }
 
     template <typename Weight>
-    Router<Weight>::Router(const Graph& graph)
+    void Router<Weight>::CheckEdgeWeight(Weight weight) {
+        if (weight < ZERO_WEIGHT) {
+            throw std::domain_error("Edges' weights should be non-negative");
+        }
+        if (std::is_integral_v<Weight> && !(weight < SATURATED)) {
+            throw std::overflow_error("Edge weight does not fit into the weight type");
+        }
+    }
+
+    template <typename Weight>
+    void Router<Weight>::CheckRow(VertexId from) const {
+        if (from < row_begin_ || from >= row_end_) {
+            throw std::out_of_range("Vertex is out of the routes matrix");
+        }
+    }
+
+    template <typename Weight>
+    Weight Router<Weight>::AddWeights(Weight lhs, Weight rhs) {
+        if constexpr (std::is_integral_v<Weight>) {
+            return rhs < SATURATED - lhs ? lhs + rhs : SATURATED;
+        }
+        else {
+            return lhs + rhs;
+        }
+    }
+
+    template <typename Weight>
+    void Router<Weight>::CheckSaturation() const {
+        if constexpr (std::is_integral_v<Weight>) {
+            if (std::find(weights_.begin(), weights_.end(), SATURATED) != weights_.end()) {
+                throw std::overflow_error("Route weights do not fit into the weight type");
+            }
+        }
+    }
+
+    template <typename Weight>
+    void Router<Weight>::MakeOwned() {
+        if (!storage_) {
+            return;
+        }
+        weights_.assign(weights_data_, weights_data_ + GetCellCount());
+        prev_edges_.assign(prev_edges_data_, prev_edges_data_ + GetCellCount());
+        storage_.reset();
+        UpdateDataPointers();
+    }
+
+    template <typename Weight>
+    void Router<Weight>::UpdateDataPointers() {
+        weights_data_ = weights_.data();
+        prev_edges_data_ = prev_edges_.data();
+    }
+
+    template <typename Weight>
+    size_t Router<Weight>::EstimateMemory(size_t vertex_count) {
+        return vertex_count * vertex_count * (sizeof(Weight) + sizeof(PrevEdge));
+    }
+
+    template <typename Weight>
+    Router<Weight>::Router(const Graph& graph, concurrency::ThreadPool* pool)
         : graph_(graph)
-        , routes_internal_data_(graph.GetVertexCount(),
-            std::vector<std::optional<RouteInternalData>>(graph.GetVertexCount()))
+        , vertex_count_(graph.GetVertexCount())
+        , row_end_(vertex_count_)
+        , weights_(vertex_count_ * vertex_count_, UNREACHABLE)
+        , prev_edges_(vertex_count_ * vertex_count_, NO_EDGE)
     {
         InitializeRoutesInternalData(graph);
+        ComputeRoutesInternalData(pool);
+        CheckSaturation();
+        UpdateDataPointers();
+    }
 
-        const size_t vertex_count = graph.GetVertexCount();
-        for (VertexId vertex_through = 0; vertex_through < vertex_count; ++vertex_through) {
-            RelaxRoutesInternalDataThroughVertex(vertex_count, vertex_through);
+    template <typename Weight>
+    Router<Weight>::Router(const Graph& graph, RoutesView routes_view)
+        : graph_(graph)
+        , vertex_count_(routes_view.vertex_count)
+        , row_end_(routes_view.vertex_count)
+        , weights_data_(routes_view.weights)
+        , prev_edges_data_(routes_view.prev_edges)
+        , storage_(std::move(routes_view.storage)) {
+        if (vertex_count_ != graph.GetVertexCount()) {
+            throw std::invalid_argument("Routes matrix does not match the graph");
         }
     }
+
     template <typename Weight>
-    Router<Weight>::Router(const Graph& graph, const transport_catalog_serialize::RoutesData& routes_data)
-        :graph_(graph)
-        , routes_internal_data_(SetDeserializeData(routes_data)) {}
+    Router<Weight>::Router(const Graph& graph, RowRange rows, concurrency::ThreadPool* pool)
+        : graph_(graph)
+        , vertex_count_(graph.GetVertexCount())
+        , row_begin_(rows.begin)
+        , row_end_(rows.end)
+    {
+        if (rows.begin >= rows.end || rows.end > vertex_count_) {
+            throw std::out_of_range("Rows are out of the routes matrix");
+        }
+        if (graph.GetEdgeCount() >= NO_EDGE) {
+            throw std::length_error("Too many edges for the routes matrix");
+        }
+        for (EdgeId edge_id = 0; edge_id < graph.GetEdgeCount(); ++edge_id) {
+            CheckEdgeWeight(graph.GetEdge(edge_id).weight);
+        }
+        weights_.assign(GetCellCount(), UNREACHABLE);
+        prev_edges_.assign(GetCellCount(), NO_EDGE);
+        concurrency::ParallelFor(pool, row_end_ - row_begin_, [&](size_t i) {
+            ComputeRow(row_begin_ + i);
+        });
+        CheckSaturation();
+        UpdateDataPointers();
+    }
 
     template <typename Weight>
     std::optional<typename Router<Weight>::RouteInfo> Router<Weight>::BuildRoute(VertexId from,
         VertexId to) const {
-        const auto& route_internal_data = routes_internal_data_.at(from).at(to);
-        if (!route_internal_data) {
+        CheckRow(from);
+        if (to >= vertex_count_) {
+            throw std::out_of_range("Vertex is out of the routes matrix");
+        }
+        const Weight weight = weights_data_[GetIndex(from, to)];
+        if (weight == UNREACHABLE) {
             return std::nullopt;
         }
-        const Weight weight = route_internal_data->weight;
+        const PrevEdge* prev_edges_from = prev_edges_data_ + GetIndex(from, 0);
         std::vector<EdgeId> edges;
-        for (std::optional<EdgeId> edge_id = route_internal_data->prev_edge;
-            edge_id;
-            edge_id = routes_internal_data_[from][graph_.GetEdge(*edge_id).from]->prev_edge)
+        for (PrevEdge edge_id = prev_edges_from[to];
+            edge_id != NO_EDGE;
+            edge_id = prev_edges_from[graph_.GetEdge(edge_id).from])
         {
-            edges.push_back(*edge_id);
+            edges.push_back(edge_id);
         }
         std::reverse(edges.begin(), edges.end());
 
         return RouteInfo{ weight, std::move(edges) };
     }
-}       // namespace graph
\ No newline at end of file
+
+    template <typename Weight>
+    typename Router<Weight>::WeightsTable Router<Weight>::BuildWeights(const std::vector<VertexId>& sources,
+        const std::vector<VertexId>& targets) const {
+        for (const VertexId vertex : sources) {
+            CheckRow(vertex);
+        }
+        for (const VertexId vertex : targets) {
+            if (vertex >= vertex_count_) {
+                throw std::out_of_range("Vertex is out of the routes matrix");
+            }
+        }
+        WeightsTable table(sources.size(), std::vector<std::optional<Weight>>(targets.size()));
+        for (size_t i = 0; i < sources.size(); ++i) {
+            const Weight* weights_from = weights_data_ + GetIndex(sources[i], 0);
+            for (size_t j = 0; j < targets.size(); ++j) {
+                if (weights_from[targets[j]] != UNREACHABLE) {
+                    table[i][j] = weights_from[targets[j]];
+                }
+            }
+        }
+        return table;
+    }
+
+    template <typename Weight>
+    typename Router<Weight>::ReachedVertices Router<Weight>::BuildReachable(VertexId from, size_t vertex_count,
+        Weight max_weight) const {
+        CheckRow(from);
+        const Weight* weights_from = weights_data_ + GetIndex(from, 0);
+        ReachedVertices reached;
+        for (VertexId vertex = 0; vertex < std::min(vertex_count, vertex_count_); ++vertex) {
+            if (weights_from[vertex] != UNREACHABLE && !(max_weight < weights_from[vertex])) {
+                reached.push_back({ vertex, weights_from[vertex] });
+            }
+        }
+        return reached;
+    }
+}       // namespace graph
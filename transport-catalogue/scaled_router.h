@@ -0,0 +1,104 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "graph.h"
+#include "router.h"
+
+namespace graph {
+    // the graph with the weights converted to the nearest whole number of ticks,
+    // edge ids stay the same; the last value of Ticks is left for "no route"
+    template <typename Ticks, typename Weight>
+    DirectedWeightedGraph<Ticks> ScaleGraph(const DirectedWeightedGraph<Weight>& graph, Weight ticks_per_unit) {
+        DirectedWeightedGraph<Ticks> result(graph.GetVertexCount());
+        result.ReserveEdges(graph.GetEdgeCount());
+        for (EdgeId edge_id = 0; edge_id < graph.GetEdgeCount(); ++edge_id) {
+            const Edge<Weight>& edge = graph.GetEdge(edge_id);
+            const Weight ticks = std::round(edge.weight * ticks_per_unit);
+            if (ticks < Weight{}) {
+                throw std::domain_error("Edges' weights should be non-negative");
+            }
+            if (!(ticks < static_cast<Weight>(std::numeric_limits<Ticks>::max()))) {
+                throw std::overflow_error("Edge weight does not fit into the weight type");
+            }
+            result.AddEdge({ edge.from, edge.to, static_cast<Ticks>(ticks) });
+        }
+        result.Finalize();
+        return result;
+    }
+
+    // a router searching a graph of integral ticks, answering in Weight units: the routes are the same
+    // as on the graph it was scaled from as long as the weights there are whole numbers of ticks
+    template <typename Weight, typename Ticks>
+    class ScaledRouter : public RouterInterface<Weight> {
+    public:         // constructors
+        ScaledRouter(std::unique_ptr<RouterInterface<Ticks>> router, Weight ticks_per_unit)
+            : router_(std::move(router)), ticks_per_unit_(ticks_per_unit) { }
+
+    public:         // methods
+        using RouteInfo = typename RouterInterface<Weight>::RouteInfo;
+        std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const override;
+        using WeightsTable = typename RouterInterface<Weight>::WeightsTable;
+        WeightsTable BuildWeights(const std::vector<VertexId>& sources, const std::vector<VertexId>& targets) const override;
+        using ReachedVertices = typename RouterInterface<Weight>::ReachedVertices;
+        ReachedVertices BuildReachable(VertexId from, size_t vertex_count, Weight max_weight) const override;
+
+        RouterInterface<Ticks>& GetRouter() { return *router_; }
+        const RouterInterface<Ticks>& GetRouter() const { return *router_; }
+
+    private:
+        Weight ToUnits(Ticks ticks) const { return static_cast<Weight>(ticks) / ticks_per_unit_; }
+        std::unique_ptr<RouterInterface<Ticks>> router_;
+        Weight ticks_per_unit_;
+    };
+
+    template <typename Weight, typename Ticks>
+    std::optional<typename ScaledRouter<Weight, Ticks>::RouteInfo> ScaledRouter<Weight, Ticks>::BuildRoute(VertexId from,
+        VertexId to) const {
+        std::optional<typename RouterInterface<Ticks>::RouteInfo> route = router_->BuildRoute(from, to);
+        if (!route) {
+            return std::nullopt;
+        }
+        return RouteInfo{ ToUnits(route->weight), std::move(route->edges) };
+    }
+
+    template <typename Weight, typename Ticks>
+    typename ScaledRouter<Weight, Ticks>::WeightsTable ScaledRouter<Weight, Ticks>::BuildWeights(
+        const std::vector<VertexId>& sources, const std::vector<VertexId>& targets) const {
+        const typename RouterInterface<Ticks>::WeightsTable ticks = router_->BuildWeights(sources, targets);
+        WeightsTable table(sources.size(), std::vector<std::optional<Weight>>(targets.size()));
+        for (size_t i = 0; i < sources.size(); ++i) {
+            for (size_t j = 0; j < targets.size(); ++j) {
+                if (ticks[i][j]) {
+                    table[i][j] = ToUnits(*ticks[i][j]);
+                }
+            }
+        }
+        return table;
+    }
+
+    template <typename Weight, typename Ticks>
+    typename ScaledRouter<Weight, Ticks>::ReachedVertices ScaledRouter<Weight, Ticks>::BuildReachable(VertexId from,
+        size_t vertex_count, Weight max_weight) const {
+        // a negative or NaN limit reaches nothing, not even the source
+        if (!(max_weight >= Weight{})) {
+            return {};
+        }
+        // the whole ticks not over the limit, the last value is "no route"
+        const Weight max_ticks = std::clamp(std::floor(max_weight * ticks_per_unit_), Weight{},
+            static_cast<Weight>(std::numeric_limits<Ticks>::max() - 1));
+        const Ticks ticks_limit = static_cast<Ticks>(max_ticks);
+        ReachedVertices reached;
+        for (const auto& [vertex, ticks] : router_->BuildReachable(from, vertex_count, ticks_limit)) {
+            reached.push_back({ vertex, ToUnits(ticks) });
+        }
+        return reached;
+    }
+}       // namespace graph
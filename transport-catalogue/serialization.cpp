@@ -1,24 +1,283 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include "mapped_file.h"
 #include "serialization.h"
 
 namespace tr_cat {
     namespace serialize {
+        using namespace std::string_literals;
+
+        namespace {
+            // the base file: the header, the AllData message, then the routes matrix (if the router keeps one)
+            // as raw row-major weights and prev edges, every section starting at a SECTION_ALIGNMENT offset,
+            // so process_requests maps the file and reads the matrix in place
+            // the matrix is either the blocks of the graph's components one after another
+            // or the rows [row_begin, row_end) of the whole graph, all of them but in a part of a sharded build
+            struct BaseHeader {
+                char magic[8];
+                uint32_t version;
+                uint32_t byte_order;            // BYTE_ORDER_MARK as written by this machine
+                uint64_t proto_offset;
+                uint64_t proto_size;
+                uint64_t vertex_count;          // of the routes matrix, 0 if there is none
+                uint32_t weight_size;           // double minutes or router::Ticks
+                uint32_t prev_edge_size;
+                uint64_t weights_offset;
+                uint64_t prev_edges_offset;
+                uint64_t row_begin;             // all the rows but in a part of a sharded build
+                uint64_t row_end;
+                uint64_t cell_count;            // of the blocks or of the rows
+            };
+
+            using MatrixCells = router::RoutesSection::Cells;
+
+            constexpr char BASE_MAGIC[8] = { 'T', 'C', 'B', 'A', 'S', 'E', '\0', '\0' };
+            constexpr uint32_t BASE_VERSION = 1;
+            constexpr uint32_t BYTE_ORDER_MARK = 0x01020304;
+            constexpr size_t SECTION_ALIGNMENT = 64;
+
+            using PrevEdge = router::RoutesSection::PrevEdge;
+
+            uint64_t AlignOffset(uint64_t offset) {
+                return (offset + SECTION_ALIGNMENT - 1) / SECTION_ALIGNMENT * SECTION_ALIGNMENT;
+            }
+
+            void WritePadding(std::ofstream& out, uint64_t offset) {
+                static const char padding[SECTION_ALIGNMENT] = {};
+                out.write(padding, static_cast<std::streamsize>(offset - static_cast<uint64_t>(out.tellp())));
+            }
+
+            bool IsInside(uint64_t offset, uint64_t size, size_t file_size) {
+                return offset <= file_size && size <= file_size - offset;
+            }
+
+            using CellsWriter = std::function<void(const MatrixCells&)>;
+
+            // header holds the matrix description and the cell count, the offsets are filled in here;
+            // write_matrix gives all the cells to its writer in order, so the matrix never has to be in memory
+            // as a whole; the old base may still be mapped by this process, it is replaced as a whole
+            size_t WriteBase(const std::filesystem::path& path, BaseHeader header, std::string_view proto,
+                             const std::function<void(const CellsWriter&)>& write_matrix) {
+                std::memcpy(header.magic, BASE_MAGIC, sizeof(BASE_MAGIC));
+                header.version = BASE_VERSION;
+                header.byte_order = BYTE_ORDER_MARK;
+                header.proto_offset = AlignOffset(sizeof(BaseHeader));
+                header.proto_size = proto.size();
+                header.prev_edge_size = sizeof(PrevEdge);
+                if (header.vertex_count > 0) {
+                    header.weights_offset = AlignOffset(header.proto_offset + header.proto_size);
+                    header.prev_edges_offset = AlignOffset(header.weights_offset + header.cell_count * header.weight_size);
+                }
+
+                std::filesystem::path temporary_path = path;
+                temporary_path += ".tmp"s;
+                {
+                    std::ofstream out(temporary_path, std::ios::binary | std::ios::trunc);
+                    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+                    WritePadding(out, header.proto_offset);
+                    out.write(proto.data(), static_cast<std::streamsize>(proto.size()));
+                    if (header.vertex_count > 0) {
+                        WritePadding(out, header.weights_offset);
+                        // both sections grow with every part, the gap between them reads as zeros
+                        uint64_t written = 0;
+                        write_matrix([&](const MatrixCells& part) {
+                            if (written + part.count > header.cell_count) {
+                                throw std::logic_error("Routes matrix has more cells than its header"s);
+                            }
+                            out.seekp(static_cast<std::streamoff>(header.weights_offset + written * header.weight_size));
+                            out.write(static_cast<const char*>(part.weights),
+                                static_cast<std::streamsize>(part.count * header.weight_size));
+                            out.seekp(static_cast<std::streamoff>(header.prev_edges_offset + written * sizeof(PrevEdge)));
+                            out.write(reinterpret_cast<const char*>(part.prev_edges),
+                                static_cast<std::streamsize>(part.count * sizeof(PrevEdge)));
+                            written += part.count;
+                        });
+                        if (written != header.cell_count) {
+                            throw std::logic_error("Routes matrix has fewer cells than its header"s);
+                        }
+                    }
+                    if (!out) {
+                        throw std::runtime_error("Can not write "s + temporary_path.string());
+                    }
+                }
+                std::filesystem::rename(temporary_path, path);
+                return static_cast<size_t>(std::filesystem::file_size(path));
+            }
+
+            size_t WriteBase(const std::filesystem::path& path, BaseHeader header, std::string_view proto,
+                             const std::vector<MatrixCells>& cells) {
+                header.cell_count = 0;
+                for (const MatrixCells& part : cells) {
+                    header.cell_count += part.count;
+                }
+                return WriteBase(path, header, proto, [&cells](const CellsWriter& write_cells) {
+                    for (const MatrixCells& part : cells) {
+                        write_cells(part);
+                    }
+                });
+            }
+
+            // the bases written before the header are a bare AllData message, they have to be rebuilt
+            BaseHeader ReadHeader(const io::MappedFile& file) {
+                BaseHeader header{};
+                std::memcpy(&header, file.data(), std::min(file.size(), sizeof(header)));
+                if (std::memcmp(header.magic, BASE_MAGIC, sizeof(BASE_MAGIC)) != 0 || header.version != BASE_VERSION
+                    || header.byte_order != BYTE_ORDER_MARK
+                    || (header.weight_size != sizeof(double) && header.weight_size != sizeof(router::Ticks))
+                    || header.prev_edge_size != sizeof(PrevEdge)) {
+                    throw std::invalid_argument("Unsupported base format"s);
+                }
+                if (header.row_begin > header.row_end || header.row_end > header.vertex_count) {
+                    throw std::invalid_argument("Base rows are out of the routes matrix"s);
+                }
+                if (!IsInside(header.proto_offset, header.proto_size, file.size())
+                    || !IsInside(header.weights_offset, header.cell_count * header.weight_size, file.size())
+                    || !IsInside(header.prev_edges_offset, header.cell_count * sizeof(PrevEdge), file.size())) {
+                    throw std::invalid_argument("Base file is truncated"s);
+                }
+                return header;
+            }
+        }
+
         size_t Serializator::Serialize(bool with_graph) const {
+            if (transport_router_.IsMatrixStreamed()) {
+                return SerializeStreamed(with_graph);
+            }
+            const std::string proto = MakeProto(with_graph);
+
+            const std::optional<router::RoutesSection> matrix = transport_router_.GetRoutesMatrix();
+            BaseHeader header{};
+            header.weight_size = sizeof(double);
+            std::vector<MatrixCells> cells;
+            if (matrix) {
+                header.vertex_count = matrix->vertex_count;
+                header.weight_size = static_cast<uint32_t>(matrix->weight_size);
+                header.row_begin = matrix->rows.begin;
+                header.row_end = matrix->rows.end;
+                cells = matrix->cells;
+            }
+            return WriteBase(path_to_serialize_, header, proto, cells);
+        }
+
+        // the rows are computed while they are written; the ticks turning out too small for a route
+        // switch the router to the double weights, which changes the proto too, so the base is written again
+        size_t Serializator::SerializeStreamed(bool with_graph) const {
+            while (true) {
+                const std::string proto = MakeProto(with_graph);
+                const router::RoutesSection layout = transport_router_.GetStreamedMatrixLayout();
+                BaseHeader header{};
+                header.vertex_count = layout.vertex_count;
+                header.weight_size = static_cast<uint32_t>(layout.weight_size);
+                header.row_begin = layout.rows.begin;
+                header.row_end = layout.rows.end;
+                header.cell_count = (header.row_end - header.row_begin) * header.vertex_count;
+                try {
+                    return WriteBase(path_to_serialize_, header, proto, [this](const CellsWriter& write_cells) {
+                        transport_router_.StreamRoutesMatrix([&write_cells](const router::RoutesSection& rows) {
+                            for (const MatrixCells& part : rows.cells) {
+                                write_cells(part);
+                            }
+                        });
+                    });
+                }
+                catch (const std::overflow_error&) {
+                    if (layout.weight_size == sizeof(double)) {
+                        throw;
+                    }
+                }
+            }
+        }
+
+        std::string Serializator::MakeProto(bool with_graph) const {
             transport_catalog_serialize::AllData all_data;
             *all_data.mutable_catalog() = catalog_.Serialize();
             *all_data.mutable_render_settings() = renderer_.Serialize();
             *all_data.mutable_router_data() = transport_router_.Serialize(with_graph);
-            std::ofstream out(path_to_serialize_, std::ios::binary | std::ios::trunc);
-            all_data.SerializePartialToOstream(&out);
-            return sizeof(path_to_serialize_);
+            return all_data.SerializePartialAsString();
+        }
+
+        size_t Serializator::Merge(const std::vector<std::filesystem::path>& parts) const {
+            // the parts come from the same input, so everything but the rows is the same in all of them
+            std::vector<std::shared_ptr<io::MappedFile>> files;
+            std::vector<BaseHeader> headers;
+            for (const std::filesystem::path& path : parts) {
+                files.push_back(std::make_shared<io::MappedFile>(path));
+                headers.push_back(ReadHeader(*files.back()));
+                const BaseHeader& header = headers.back();
+                if (header.vertex_count == 0 || header.cell_count != (header.row_end - header.row_begin) * header.vertex_count) {
+                    throw std::invalid_argument(path.string() + " holds no part of a routes matrix"s);
+                }
+            }
+            if (files.empty()) {
+                throw std::invalid_argument("No parts to merge"s);
+            }
+            auto get_proto = [&](size_t i) {
+                return std::string_view(files[i]->data() + headers[i].proto_offset, headers[i].proto_size);
+            };
+            for (size_t i = 1; i < files.size(); ++i) {
+                if (get_proto(i) != get_proto(0) || headers[i].vertex_count != headers[0].vertex_count
+                    || headers[i].weight_size != headers[0].weight_size) {
+                    throw std::invalid_argument("Parts were built from different data or settings: "s + parts[i].string());
+                }
+            }
+
+            std::vector<size_t> order(files.size());
+            std::iota(order.begin(), order.end(), 0);
+            std::sort(order.begin(), order.end(), [&](size_t lhs, size_t rhs) {
+                return headers[lhs].row_begin < headers[rhs].row_begin;
+            });
+            std::vector<MatrixCells> cells;
+            uint64_t next_row = 0;
+            for (const size_t i : order) {
+                if (headers[i].row_begin != next_row) {
+                    throw std::invalid_argument("Parts do not cover the rows from "s + std::to_string(next_row)
+                        + " exactly once"s);
+                }
+                cells.push_back({ files[i]->data() + headers[i].weights_offset,
+                                  reinterpret_cast<const PrevEdge*>(files[i]->data() + headers[i].prev_edges_offset),
+                                  static_cast<size_t>(headers[i].cell_count) });
+                next_row = headers[i].row_end;
+            }
+            if (next_row != headers[0].vertex_count) {
+                throw std::invalid_argument("Parts do not cover the rows from "s + std::to_string(next_row));
+            }
+
+            BaseHeader header{};
+            header.vertex_count = headers[0].vertex_count;
+            header.weight_size = headers[0].weight_size;
+            header.row_begin = 0;
+            header.row_end = header.vertex_count;
+            return WriteBase(path_to_serialize_, header, get_proto(0), cells);
         }
 
         bool Serializator::Deserialize(bool with_graph) {
+            auto file = std::make_shared<io::MappedFile>(path_to_serialize_);
             transport_catalog_serialize::AllData all_data;
-            std::ifstream in(path_to_serialize_, std::ios::binary);
-            all_data.ParseFromIstream(&in);
+            std::optional<router::RoutesSection> routes_section;
+
+            const BaseHeader header = ReadHeader(*file);
+            all_data.ParseFromArray(file->data() + header.proto_offset, static_cast<int>(header.proto_size));
+            if (header.vertex_count > 0) {
+                routes_section = router::RoutesSection{ static_cast<size_t>(header.vertex_count),
+                    { static_cast<graph::VertexId>(header.row_begin), static_cast<graph::VertexId>(header.row_end) },
+                    header.weight_size,
+                    { { file->data() + header.weights_offset,
+                        reinterpret_cast<const PrevEdge*>(file->data() + header.prev_edges_offset),
+                        static_cast<size_t>(header.cell_count) } },
+                    file };
+            }
             catalog_.Deserialize(*all_data.mutable_catalog());
             renderer_.Deserialize(*all_data.mutable_render_settings());
-            transport_router_.Deserialize(*all_data.mutable_router_data(), with_graph);
+            transport_router_.Deserialize(*all_data.mutable_router_data(), with_graph, std::move(routes_section));
             return true;
         }
     }       // namespace serialize
@@ -20,7 +20,14 @@ namespace tr_cat {
         public:         // methods
             void SetPathToSerialize(const std::filesystem::path& path) { path_to_serialize_ = path; }
             size_t Serialize(bool with_graph = false) const;
+            // writes the base from the parts of a sharded make_base, each holding some rows of the routes matrix
+            size_t Merge(const std::vector<std::filesystem::path>& parts) const;
             bool Deserialize(bool with_graph = false);
+
+        private:        // methods
+            // writes the routes matrix while the router computes it, a batch of rows at a time
+            size_t SerializeStreamed(bool with_graph) const;
+            std::string MakeProto(bool with_graph) const;
         };
 
     }   // namespace serialize
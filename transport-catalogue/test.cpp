@@ -74,12 +74,11 @@ namespace tr_cat {
                     reader.AddBuses();
                 }
             }
-            render::MapRenderer render(catalog, reader.GetRenderSettings(), outf);
             {
                 LOG_DURATION("RENDERING"s);
                 {
                     LOG_DURATION("    DRAWING         "s);
-                    render.Render();
+                    reader.RenderMap(outf);
                 }
             }
             std::cerr << "-----------------------------------\n\n"s;
@@ -3,7 +3,7 @@
 #include <iostream>
 #include <fstream>
 #include <string>
-#include <strstream>
+#include <sstream>
 
 #include "transport_catalogue.h"
 #include "log_duration.h"
@@ -39,6 +39,12 @@ namespace tr_cat {
                 std::cerr << func_name << " OK"s << std::endl;
             }
 
+            template <typename Func>
+            void RunUnitTestImpl(Func func, const std::string& func_name) {
+                func();
+                std::cerr << func_name << " OK"s << std::endl;
+            }
+
         } //detail
 
 #define ASSERT_EQUAL(value1, value2) detail::AssertEqualImpl((value1), (value2), #value1, #value2, __FILE__, __FUNCTION__, __LINE__)
@@ -48,10 +54,13 @@ namespace tr_cat {
 #define ASSERT_HINT(expr, hint) detail::AssertImpl((expr), #expr, __FILE__, __FUNCTION__, __LINE__, hint)
 
 #define RUN_TEST(func, file_in, file_out, file_example) detail::RunTestImpl((func), #func, (file_in), (file_out), (file_example))
+#define RUN_UNIT_TEST(func) detail::RunUnitTestImpl((func), #func)
 
         void TestOutput(const std::string& file_in, const std::string& file_out, const std::string& file_example);
         void TestRenderSpeed(const std::string& file_in, const std::string& file_out);
         void TestCatalogSpeed(const std::string& file_in, const std::string& file_out, const std::string&);
         void Test(const std::string file_in, const std::string file_out, const std::string file_example);
+        // the routers of every kind against the routes matrix of Floyd-Warshall on generated catalogues
+        void TestRouters();
     }//tests
 }//tr_cat
@@ -0,0 +1,1263 @@
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <map>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+#include "json.h"
+#include "json_reader.h"
+#include "min_plus.h"
+#include "test.h"
+#include "transport_router.h"
+#include "serialization.h"
+
+using namespace std::string_literals;
+
+namespace tr_cat {
+    namespace tests {
+        namespace {
+            const int TEST_WAIT_TIME = 6;
+            const int TEST_VELOCITY = 40;
+            const double NO_ROUTE = std::numeric_limits<double>::infinity();
+
+            struct TestBus {
+                std::string name;
+                std::vector<std::string> stops;         // the last one is the first one for a ring
+                bool is_ring;
+            };
+
+            struct TestNetwork {
+                std::vector<std::pair<std::string, geo::Coordinates>> stops;
+                std::vector<std::tuple<std::string, std::string, int>> distances;
+                std::vector<TestBus> buses;
+            };
+
+            // a catalogue, a router of it and what the base keeps along with them
+            struct Base {
+                aggregations::TransportCatalogue catalog;
+                render::MapRenderer renderer{ catalog };
+                router::TransportRouter router{ catalog };
+            };
+
+            std::string GridStop(size_t row, size_t column) {
+                return "S"s + std::to_string(row) + "_"s + std::to_string(column);
+            }
+
+            // a grid of size x size stops with random road distances between the neighbours, some of them one way,
+            // crossed by linear buses along the rows and columns, ring buses around some of the squares and buses
+            // wandering over it; an island of three stops with a ring bus of its own and a stop no bus serves
+            TestNetwork MakeNetwork(size_t size, uint32_t seed) {
+                std::mt19937 generator(seed);
+                auto random = [&generator](int min, int max) {
+                    return std::uniform_int_distribution<int>(min, max)(generator);
+                };
+                TestNetwork network;
+                for (size_t row = 0; row < size; ++row) {
+                    for (size_t column = 0; column < size; ++column) {
+                        network.stops.push_back({ GridStop(row, column), { 55.6 + 0.01 * row, 37.6 + 0.01 * column } });
+                    }
+                }
+                for (size_t row = 0; row < size; ++row) {
+                    for (size_t column = 0; column < size; ++column) {
+                        for (const auto& [next_row, next_column] : { std::pair{ row + 1, column }, std::pair{ row, column + 1 } }) {
+                            if (next_row == size || next_column == size) {
+                                continue;
+                            }
+                            network.distances.push_back({ GridStop(row, column), GridStop(next_row, next_column), random(300, 3000) });
+                            if (random(0, 1) == 1) {
+                                network.distances.push_back({ GridStop(next_row, next_column), GridStop(row, column), random(300, 3000) });
+                            }
+                        }
+                    }
+                }
+
+                for (size_t i = 0; i < size; ++i) {
+                    TestBus row_bus{ "R"s + std::to_string(i), {}, false };
+                    TestBus column_bus{ "C"s + std::to_string(i), {}, false };
+                    for (size_t j = 0; j < size; ++j) {
+                        row_bus.stops.push_back(GridStop(i, j));
+                        column_bus.stops.push_back(GridStop(j, i));
+                    }
+                    network.buses.push_back(std::move(row_bus));
+                    if (i % 2 == 0) {
+                        network.buses.push_back(std::move(column_bus));
+                    }
+                }
+                for (size_t i = 0; i + 1 < size; i += 2) {
+                    const size_t row = static_cast<size_t>(random(0, static_cast<int>(size) - 2));
+                    network.buses.push_back({ "Q"s + std::to_string(i), { GridStop(row, i), GridStop(row, i + 1),
+                        GridStop(row + 1, i + 1), GridStop(row + 1, i), GridStop(row, i) }, true });
+                }
+                for (size_t i = 0; i < size; ++i) {
+                    TestBus bus{ "W"s + std::to_string(i), {}, random(0, 1) == 1 };
+                    size_t row = static_cast<size_t>(random(0, static_cast<int>(size) - 1));
+                    size_t column = static_cast<size_t>(random(0, static_cast<int>(size) - 1));
+                    const int length = random(2, 7);
+                    for (int step = 0; step < length; ++step) {
+                        bus.stops.push_back(GridStop(row, column));
+                        row = std::min(size - 1, row + random(0, 1));
+                        column = std::min(size - 1, column + random(0, 1));
+                    }
+                    if (bus.is_ring) {
+                        bus.stops.push_back(bus.stops.front());
+                    }
+                    network.buses.push_back(std::move(bus));
+                }
+
+                network.stops.push_back({ "Island 0"s, { 55.0, 37.0 } });
+                network.stops.push_back({ "Island 1"s, { 55.01, 37.0 } });
+                network.stops.push_back({ "Island 2"s, { 55.01, 37.01 } });
+                network.distances.push_back({ "Island 0"s, "Island 1"s, 1200 });
+                network.distances.push_back({ "Island 1"s, "Island 2"s, 900 });
+                network.distances.push_back({ "Island 2"s, "Island 0"s, 1500 });
+                network.buses.push_back({ "Ferry"s, { "Island 0"s, "Island 1"s, "Island 2"s, "Island 0"s }, true });
+                network.stops.push_back({ "Lonely"s, { 56.0, 38.0 } });
+                return network;
+            }
+
+            void AddBus(aggregations::TransportCatalogue& catalog, const TestBus& bus) {
+                std::vector<std::string_view> stops(bus.stops.begin(), bus.stops.end());
+                catalog.AddBus(bus.name, stops, bus.is_ring);
+            }
+
+            // all the stops and distances, and the buses but the last skipped_buses ones
+            void FillCatalog(aggregations::TransportCatalogue& catalog, const TestNetwork& network, size_t skipped_buses = 0) {
+                for (const auto& [name, coordinates] : network.stops) {
+                    catalog.AddStop(name, coordinates);
+                }
+                for (const auto& [from, to, distance] : network.distances) {
+                    catalog.AddDistance(from, to, distance);
+                }
+                for (size_t i = 0; i + skipped_buses < network.buses.size(); ++i) {
+                    AddBus(catalog, network.buses[i]);
+                }
+            }
+
+            router::RoutingSettings MakeSettings(router::RouterType router_type) {
+                router::RoutingSettings settings;
+                settings.bus_wait_time = TEST_WAIT_TIME;
+                settings.bus_velocity = TEST_VELOCITY;
+                settings.router_type = router_type;
+                return settings;
+            }
+
+            std::unique_ptr<Base> MakeBase(const TestNetwork& network, router::RoutingSettings settings) {
+                auto base = std::make_unique<Base>();
+                FillCatalog(base->catalog, network);
+                base->router.SetSettings(std::move(settings));
+                base->router.CreateGraph();
+                return base;
+            }
+
+            std::filesystem::path GetTemporaryPath(const std::string& name) {
+                return std::filesystem::temp_directory_path() / ("transport_catalogue_tests_"s + name + ".db"s);
+            }
+
+            void SaveBase(Base& base, const std::filesystem::path& path) {
+                serialize::Serializator serializator(base.catalog, base.renderer, base.router);
+                serializator.SetPathToSerialize(path);
+                serializator.Serialize(true);
+            }
+
+            std::unique_ptr<Base> LoadBase(const std::filesystem::path& path, bool with_graph = true) {
+                auto base = std::make_unique<Base>();
+                serialize::Serializator serializator(base->catalog, base->renderer, base->router);
+                serializator.SetPathToSerialize(path);
+                serializator.Deserialize(with_graph);
+                return base;
+            }
+
+            // overwrites the bytes of a saved base at the offset with the value
+            template <typename Value>
+            void PatchBase(const std::filesystem::path& path, std::streamoff offset, Value value) {
+                std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+                file.seekp(offset);
+                file.write(reinterpret_cast<const char*>(&value), sizeof(value));
+            }
+
+            std::vector<const Stop*> GetStops(const aggregations::TransportCatalogue& catalog) {
+                std::vector<const Stop*> stops;
+                for (std::string_view name : catalog.GetSortedStopsNames()) {
+                    stops.push_back(*catalog.GetStopInfo(name));
+                }
+                return stops;
+            }
+
+            double GetRideTime(const aggregations::TransportCatalogue& catalog, const Bus* bus, size_t index, int velocity) {
+                return catalog.GetDistance(bus->stops[index], bus->stops[index + 1]) / (velocity * 1000.0 / 60);
+            }
+
+            // the travel times between the stops by Stop::vertex_id, NO_ROUTE if there is none:
+            // Floyd-Warshall over the rides of the buses from every stop to every later one
+            std::vector<std::vector<double>> ComputeFloydTimes(const aggregations::TransportCatalogue& catalog,
+                                                               int wait_time = TEST_WAIT_TIME, int velocity = TEST_VELOCITY) {
+                const size_t stop_count = catalog.GetVertexCount();
+                std::vector<std::vector<double>> times(stop_count, std::vector<double>(stop_count, NO_ROUTE));
+                for (size_t i = 0; i < stop_count; ++i) {
+                    times[i][i] = 0;
+                }
+                for (std::string_view bus_name : catalog) {
+                    const Bus* bus = *catalog.GetBusInfo(bus_name);
+                    for (size_t from = 0; from + 1 < bus->stops.size(); ++from) {
+                        double time = wait_time;
+                        for (size_t to = from + 1; to < bus->stops.size(); ++to) {
+                            time += GetRideTime(catalog, bus, to - 1, velocity);
+                            double& best = times[bus->stops[from]->vertex_id][bus->stops[to]->vertex_id];
+                            best = std::min(best, time);
+                        }
+                    }
+                }
+                for (size_t through = 0; through < stop_count; ++through) {
+                    for (size_t from = 0; from < stop_count; ++from) {
+                        for (size_t to = 0; to < stop_count; ++to) {
+                            times[from][to] = std::min(times[from][to], times[from][through] + times[through][to]);
+                        }
+                    }
+                }
+                return times;
+            }
+
+            bool IsSameTime(double lhs, double rhs) {
+                return (lhs == NO_ROUTE && rhs == NO_ROUTE) || std::abs(lhs - rhs) < 1e-6;
+            }
+
+            // every line boards the bus at the stop the previous one got off, rides it as long as the bus does
+            // and the whole route takes its total time, getting to the target
+            void CheckRoute(const aggregations::TransportCatalogue& catalog, const Stop* from, const Stop* to,
+                            const router::CompletedRoute& route, int wait_time, int velocity, const std::string& hint) {
+                // a bus may pass a stop more than once, every way it could have gone is followed
+                std::vector<const Stop*> stops{ from };
+                double total_time = 0;
+                for (const router::CompletedRoute::Line& line : route.route) {
+                    ASSERT_HINT(std::count(stops.begin(), stops.end(), line.stop) > 0 && line.count_stops > 0, hint);
+                    ASSERT_HINT(IsSameTime(line.wait_time, wait_time), hint);
+                    stops.clear();
+                    for (size_t board = 0; board + line.count_stops < line.bus->stops.size(); ++board) {
+                        if (line.bus->stops[board] != line.stop) {
+                            continue;
+                        }
+                        double run_time = 0;
+                        for (size_t i = board; i < board + line.count_stops; ++i) {
+                            run_time += GetRideTime(catalog, line.bus, i, velocity);
+                        }
+                        if (IsSameTime(run_time, line.run_time)) {
+                            stops.push_back(line.bus->stops[board + line.count_stops]);
+                        }
+                    }
+                    total_time += line.wait_time + line.run_time;
+                }
+                ASSERT_HINT(std::count(stops.begin(), stops.end(), to) > 0, hint);
+                ASSERT_HINT(IsSameTime(total_time, route.total_time), hint);
+            }
+
+            // the routes between all the stops take the times of Floyd-Warshall and are made of real rides
+            void AssertRoutesMatchFloyd(router::TransportRouter& router, const aggregations::TransportCatalogue& catalog,
+                                        const std::string& hint, int wait_time = TEST_WAIT_TIME, int velocity = TEST_VELOCITY) {
+                const std::vector<std::vector<double>> times = ComputeFloydTimes(catalog, wait_time, velocity);
+                for (const Stop* from : GetStops(catalog)) {
+                    for (const Stop* to : GetStops(catalog)) {
+                        const std::string route_hint = hint + ": "s + from->name + " -> "s + to->name;
+                        const double expected = times[from->vertex_id][to->vertex_id];
+                        const std::optional<router::CompletedRoute> route = router.ComputeRoute(from, to);
+                        ASSERT_HINT(route.has_value() == (expected != NO_ROUTE), route_hint);
+                        if (route) {
+                            ASSERT_HINT(IsSameTime(route->total_time, expected), route_hint);
+                            CheckRoute(catalog, from, to, *route, wait_time, velocity, route_hint);
+                        }
+                    }
+                }
+            }
+
+            // the travel times of the matrix between the stops, an empty one for no route
+            void AssertTimesMatchFloyd(const router::TransportRouter& router, const aggregations::TransportCatalogue& catalog,
+                                       const std::vector<const Stop*>& from, const std::vector<const Stop*>& to,
+                                       const std::string& hint, int wait_time = TEST_WAIT_TIME, int velocity = TEST_VELOCITY) {
+                const std::vector<std::vector<double>> floyd_times = ComputeFloydTimes(catalog, wait_time, velocity);
+                const std::vector<std::vector<std::optional<double>>> times = router.ComputeTimes(from, to);
+                ASSERT_EQUAL(times.size(), from.size());
+                for (size_t i = 0; i < from.size(); ++i) {
+                    ASSERT_EQUAL(times[i].size(), to.size());
+                    for (size_t j = 0; j < to.size(); ++j) {
+                        const double expected = floyd_times[from[i]->vertex_id][to[j]->vertex_id];
+                        ASSERT_HINT(IsSameTime(times[i][j].value_or(NO_ROUTE), expected),
+                                    hint + ": "s + from[i]->name + " -> "s + to[j]->name);
+                    }
+                }
+            }
+
+            // the answers to the stat requests the way process_requests gives them, but with no base in between
+            json::Array ProcessRequests(const TestNetwork& network, json::Dict routing_settings, json::Array stat_requests) {
+                std::map<std::string, json::Dict> road_distances;
+                for (const auto& [from, to, distance] : network.distances) {
+                    road_distances[from][to] = distance;
+                }
+                json::Array base_requests;
+                for (const auto& [name, coordinates] : network.stops) {
+                    base_requests.push_back(json::Dict{ { "type"s, "Stop"s }, { "name"s, name },
+                        { "latitude"s, coordinates.lat }, { "longitude"s, coordinates.lng },
+                        { "road_distances"s, road_distances[name] } });
+                }
+                for (const TestBus& bus : network.buses) {
+                    base_requests.push_back(json::Dict{ { "type"s, "Bus"s }, { "name"s, bus.name },
+                        { "stops"s, json::Array(bus.stops.begin(), bus.stops.end()) }, { "is_roundtrip"s, bus.is_ring } });
+                }
+                json::Document document(json::Dict{ { "base_requests"s, base_requests },
+                    { "routing_settings"s, routing_settings }, { "stat_requests"s, stat_requests } });
+                std::stringstream input;
+                json::Print(document, input);
+                std::stringstream output;
+                aggregations::TransportCatalogue catalog;
+                interface::JsonReader reader(catalog, input, output);
+                reader.ReadDocument();
+                reader.ParseDocument();
+                reader.AddStops();
+                reader.AddDistances();
+                reader.AddBuses();
+                reader.CreateGraph();
+                reader.GetAnswers();
+                reader.PrintAnswers();
+                return json::Load(output).GetRoot().AsArray();
+            }
+
+            json::Dict MakeJsonSettings(const std::string& router_type) {
+                return { { "bus_wait_time"s, TEST_WAIT_TIME }, { "bus_velocity"s, TEST_VELOCITY }, { "router"s, router_type } };
+            }
+
+            void TestDijkstraRouter() {
+                const TestNetwork network = MakeNetwork(6, 1);
+                std::unique_ptr<Base> base = MakeBase(network, MakeSettings(router::RouterType::MATRIX));
+                AssertRoutesMatchFloyd(base->router, base->catalog, "matrix"s);
+
+                // a cache of a few rows keeps evicting them
+                router::RoutingSettings settings = MakeSettings(router::RouterType::DIJKSTRA);
+                settings.router_memory_limit = 3 * graph::DijkstraRouter<double>::EstimateRowMemory(network.stops.size());
+                base = MakeBase(network, settings);
+                AssertRoutesMatchFloyd(base->router, base->catalog, "dijkstra"s);
+
+                // the auto router takes the matrix while it fits into the memory limit
+                settings = MakeSettings(router::RouterType::AUTO);
+                base = MakeBase(network, settings);
+                ASSERT(base->router.GetRouterType() == router::RouterType::MATRIX);
+                settings.router_memory_limit = 1024;
+                base = MakeBase(network, settings);
+                ASSERT(base->router.GetRouterType() == router::RouterType::DIJKSTRA);
+                AssertRoutesMatchFloyd(base->router, base->catalog, "auto"s);
+            }
+
+            // the queries share the row cache of the router and the routes cache
+            void TestConcurrentQueries() {
+                const TestNetwork network = MakeNetwork(6, 2);
+                router::RoutingSettings settings = MakeSettings(router::RouterType::DIJKSTRA);
+                settings.router_memory_limit = 3 * graph::DijkstraRouter<double>::EstimateRowMemory(network.stops.size());
+                settings.route_cache_size = 16;
+                std::unique_ptr<Base> base = MakeBase(network, settings);
+                std::vector<std::thread> threads;
+                for (int i = 0; i < 4; ++i) {
+                    threads.emplace_back([&base, i] {
+                        AssertRoutesMatchFloyd(base->router, base->catalog, "thread "s + std::to_string(i));
+                    });
+                }
+                for (std::thread& thread : threads) {
+                    thread.join();
+                }
+            }
+
+            // more vertices than a block of the matrix, relaxed on one thread and on several
+            void TestParallelMatrix() {
+                const TestNetwork network = MakeNetwork(9, 4);
+                for (const size_t build_threads : { 1, 4 }) {
+                    router::RoutingSettings settings = MakeSettings(router::RouterType::MATRIX);
+                    settings.build_threads = build_threads;
+                    std::unique_ptr<Base> base = MakeBase(network, settings);
+                    AssertRoutesMatchFloyd(base->router, base->catalog, std::to_string(build_threads) + " threads"s);
+                }
+            }
+
+            void TestContractionHierarchy() {
+                const TestNetwork network = MakeNetwork(7, 5);
+                const std::filesystem::path path = GetTemporaryPath("contraction_hierarchy"s);
+                std::unique_ptr<Base> base = MakeBase(network, MakeSettings(router::RouterType::CONTRACTION_HIERARCHY));
+                AssertRoutesMatchFloyd(base->router, base->catalog, "contraction hierarchy"s);
+                SaveBase(*base, path);
+                std::unique_ptr<Base> loaded = LoadBase(path);
+                ASSERT(loaded->router.GetRouterType() == router::RouterType::CONTRACTION_HIERARCHY);
+                AssertRoutesMatchFloyd(loaded->router, loaded->catalog, "loaded contraction hierarchy"s);
+                std::filesystem::remove(path);
+            }
+
+            void TestLinearGraph() {
+                const TestNetwork network = MakeNetwork(6, 6);
+                for (const router::RouterType router_type : { router::RouterType::MATRIX, router::RouterType::DIJKSTRA }) {
+                    router::RoutingSettings settings = MakeSettings(router_type);
+                    settings.graph_model = router::GraphModel::LINEAR;
+                    std::unique_ptr<Base> base = MakeBase(network, settings);
+                    AssertRoutesMatchFloyd(base->router, base->catalog, "linear graph"s);
+                }
+            }
+
+            // the incident edges of every vertex in the order they were added, the routes over them
+            // the same as of the Floyd-Warshall matrix
+            void TestCompressedGraph() {
+                std::mt19937 generator(7);
+                auto random = [&generator](size_t max) {
+                    return std::uniform_int_distribution<size_t>(0, max)(generator);
+                };
+                const size_t vertex_count = 50;
+                graph::DirectedWeightedGraph<double> graph(vertex_count);
+                std::vector<std::vector<graph::EdgeId>> added(vertex_count);
+                for (size_t i = 0; i < 300; ++i) {
+                    const graph::Edge<double> edge{ random(vertex_count - 1), random(vertex_count - 1), 1.0 + random(100) };
+                    added[edge.from].push_back(graph.AddEdge(edge));
+                    if (i == 150) {
+                        graph.Finalize();
+                    }
+                }
+                ASSERT(!graph.IsFinalized());
+                graph.Finalize();
+                for (graph::VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+                    std::vector<graph::EdgeId> incident;
+                    for (const graph::IncidentEdge<double>& edge : graph.GetIncidentEdges(vertex)) {
+                        ASSERT_EQUAL(graph.GetEdge(edge.id).from, vertex);
+                        ASSERT_EQUAL(graph.GetEdge(edge.id).to, edge.to);
+                        ASSERT_EQUAL(graph.GetEdge(edge.id).weight, edge.weight);
+                        incident.push_back(edge.id);
+                    }
+                    ASSERT(incident == added[vertex]);
+                }
+
+                const graph::Router<double> floyd(graph);
+                const graph::DijkstraRouter<double> dijkstra(graph, 4);
+                for (graph::VertexId from = 0; from < vertex_count; ++from) {
+                    for (graph::VertexId to = 0; to < vertex_count; ++to) {
+                        const auto expected = floyd.BuildRoute(from, to);
+                        const auto route = dijkstra.BuildRoute(from, to);
+                        ASSERT(expected.has_value() == route.has_value());
+                        if (!route) {
+                            continue;
+                        }
+                        ASSERT(IsSameTime(expected->weight, route->weight));
+                        double weight = 0;
+                        graph::VertexId vertex = from;
+                        for (const graph::EdgeId edge_id : route->edges) {
+                            ASSERT_EQUAL(graph.GetEdge(edge_id).from, vertex);
+                            weight += graph.GetEdge(edge_id).weight;
+                            vertex = graph.GetEdge(edge_id).to;
+                        }
+                        ASSERT_EQUAL(vertex, to);
+                        ASSERT(IsSameTime(weight, route->weight));
+                    }
+                }
+            }
+
+            void TestMatrixRequest() {
+                const TestNetwork network = MakeNetwork(6, 8);
+                for (const router::RouterType router_type : { router::RouterType::MATRIX, router::RouterType::DIJKSTRA }) {
+                    std::unique_ptr<Base> base = MakeBase(network, MakeSettings(router_type));
+                    std::vector<const Stop*> from = GetStops(base->catalog);
+                    std::vector<const Stop*> to(from.rbegin(), from.rend());
+                    from.push_back(from.front());
+                    AssertTimesMatchFloyd(base->router, base->catalog, from, to, "times"s);
+                }
+
+                // the rows and columns go in the order of the request, repeated stops included
+                const std::vector<std::string> names = { "S0_0"s, "Lonely"s, "Island 0"s, "S0_0"s, "S5_5"s };
+                json::Dict request{ { "id"s, 1 }, { "type"s, "Matrix"s },
+                    { "from"s, json::Array(names.begin(), names.end()) }, { "to"s, json::Array(names.rbegin(), names.rend()) } };
+                json::Array answers = ProcessRequests(network, MakeJsonSettings("matrix"s), { request });
+                aggregations::TransportCatalogue catalog;
+                FillCatalog(catalog, network);
+                const std::vector<std::vector<double>> floyd_times = ComputeFloydTimes(catalog);
+                ASSERT_EQUAL(answers.size(), 1u);
+                ASSERT_EQUAL(answers[0].AsMap().at("request_id"s).AsInt(), 1);
+                json::Array& rows = answers[0].AsMap().at("times"s).AsArray();
+                ASSERT_EQUAL(rows.size(), names.size());
+                for (size_t i = 0; i < names.size(); ++i) {
+                    json::Array& row = rows[i].AsArray();
+                    ASSERT_EQUAL(row.size(), names.size());
+                    for (size_t j = 0; j < names.size(); ++j) {
+                        const double expected = floyd_times[(*catalog.GetStopInfo(names[i]))->vertex_id]
+                                                           [(*catalog.GetStopInfo(names[names.size() - 1 - j]))->vertex_id];
+                        ASSERT_HINT(IsSameTime(row[j].IsNull() ? NO_ROUTE : row[j].AsDouble(), expected), names[i]);
+                    }
+                }
+            }
+
+            // the routes given from the cache are the same as built, a cache smaller than the queries keeps missing
+            void TestRoutesCache() {
+                const TestNetwork network = MakeNetwork(6, 9);
+                const size_t pair_count = (network.stops.size() - 1) * (network.stops.size() - 1);      // Lonely is never cached
+                router::RoutingSettings settings = MakeSettings(router::RouterType::DIJKSTRA);
+                settings.route_cache_size = pair_count;
+                std::unique_ptr<Base> base = MakeBase(network, settings);
+                AssertRoutesMatchFloyd(base->router, base->catalog, "built routes"s);
+                ASSERT_EQUAL(base->router.GetRouteCacheStats().hits, 0u);
+                ASSERT_EQUAL(base->router.GetRouteCacheStats().misses, pair_count);
+                AssertRoutesMatchFloyd(base->router, base->catalog, "cached routes"s);
+                ASSERT_EQUAL(base->router.GetRouteCacheStats().hits, pair_count);
+                ASSERT_EQUAL(base->router.GetRouteCacheStats().misses, pair_count);
+
+                settings = MakeSettings(router::RouterType::DIJKSTRA);
+                settings.route_cache_size = 16;
+                base = MakeBase(network, settings);
+                AssertRoutesMatchFloyd(base->router, base->catalog, "evicted routes"s);
+                AssertRoutesMatchFloyd(base->router, base->catalog, "evicted routes"s);
+                ASSERT_EQUAL(base->router.GetRouteCacheStats().hits, 0u);
+                ASSERT_EQUAL(base->router.GetRouteCacheStats().misses, 2 * pair_count);
+            }
+
+            // a bus over the served stops updates the matrix in place, a bus serving new stops rebuilds the router
+            void TestAddBus() {
+                const TestNetwork network = MakeNetwork(6, 10);
+                for (const router::RouterType router_type : { router::RouterType::MATRIX, router::RouterType::DIJKSTRA }) {
+                    for (const size_t build_threads : { 1, 4 }) {
+                        const std::string hint = std::to_string(build_threads) + " threads"s;
+                        auto base = std::make_unique<Base>();
+                        FillCatalog(base->catalog, network, 2);
+                        router::RoutingSettings settings = MakeSettings(router_type);
+                        settings.build_threads = build_threads;
+                        base->router.SetSettings(std::move(settings));
+                        base->router.CreateGraph();
+                        AssertRoutesMatchFloyd(base->router, base->catalog, hint);
+                        for (size_t i = network.buses.size() - 2; i < network.buses.size(); ++i) {
+                            AddBus(base->catalog, network.buses[i]);
+                            base->router.AddBus(*base->catalog.GetBusInfo(network.buses[i].name));
+                            AssertRoutesMatchFloyd(base->router, base->catalog, hint + ", added "s + network.buses[i].name);
+                        }
+                    }
+                }
+            }
+
+            // A* over both graph models, on several threads at once, and with the landmarks read from a base
+            void TestGoalDirection() {
+                const TestNetwork network = MakeNetwork(6, 11);
+                const std::filesystem::path path = GetTemporaryPath("goal_direction"s);
+                for (const router::GoalDirection goal_direction : { router::GoalDirection::GEO, router::GoalDirection::LANDMARKS }) {
+                    for (const router::GraphModel graph_model : { router::GraphModel::COMPLETE, router::GraphModel::LINEAR }) {
+                        const std::string hint = goal_direction == router::GoalDirection::GEO ? "geo"s : "landmarks"s;
+                        router::RoutingSettings settings = MakeSettings(router::RouterType::DIJKSTRA);
+                        settings.goal_direction = goal_direction;
+                        settings.graph_model = graph_model;
+                        settings.landmark_count = 4;
+                        settings.route_cache_size = 1;
+                        std::unique_ptr<Base> base = MakeBase(network, settings);
+                        std::vector<std::thread> threads;
+                        for (int i = 0; i < 4; ++i) {
+                            threads.emplace_back([&base, &hint, i] {
+                                AssertRoutesMatchFloyd(base->router, base->catalog, hint + ", thread "s + std::to_string(i));
+                            });
+                        }
+                        for (std::thread& thread : threads) {
+                            thread.join();
+                        }
+                        const std::vector<const Stop*> stops = GetStops(base->catalog);
+                        AssertTimesMatchFloyd(base->router, base->catalog, stops, stops, hint + " times"s);
+
+                        SaveBase(*base, path);
+                        std::unique_ptr<Base> loaded = LoadBase(path);
+                        AssertRoutesMatchFloyd(loaded->router, loaded->catalog, "loaded "s + hint);
+                    }
+                }
+                std::filesystem::remove(path);
+            }
+
+            // a base of the header version loads; a base of another version and a base written before the header,
+            // a bare message with the routes matrix as rows of messages inside, are refused
+            void TestBaseVersions() {
+                const TestNetwork network = MakeNetwork(6, 12);
+                const std::filesystem::path path = GetTemporaryPath("base_versions"s);
+                const std::streamoff VERSION_OFFSET = 8;
+                auto is_refused = [&path] {
+                    try {
+                        LoadBase(path);
+                    }
+                    catch (const std::invalid_argument&) {
+                        return true;
+                    }
+                    return false;
+                };
+
+                std::unique_ptr<Base> base = MakeBase(network, MakeSettings(router::RouterType::MATRIX));
+                SaveBase(*base, path);
+                std::unique_ptr<Base> loaded = LoadBase(path);
+                AssertRoutesMatchFloyd(loaded->router, loaded->catalog, "current version"s);
+
+                PatchBase(path, VERSION_OFFSET, std::numeric_limits<uint32_t>::max());
+                ASSERT_HINT(is_refused(), "other version"s);
+
+                transport_catalog_serialize::AllData all_data;
+                *all_data.mutable_catalog() = base->catalog.Serialize();
+                *all_data.mutable_render_settings() = base->renderer.Serialize();
+                *all_data.mutable_router_data() = base->router.Serialize(true);
+                all_data.mutable_router_data()->MergeFromString("\x12\x06\x0A\x04\x0A\x02\x08\x01"s);
+                {
+                    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+                    all_data.SerializeToOstream(&out);
+                }
+                ASSERT_HINT(is_refused(), "no header"s);
+                std::filesystem::remove(path);
+            }
+
+            // the graph read from the edge columns and rebuilt from the catalogue
+            void TestGraphColumns() {
+                const TestNetwork network = MakeNetwork(6, 13);
+                const std::filesystem::path path = GetTemporaryPath("graph_columns"s);
+                for (const router::GraphModel graph_model : { router::GraphModel::COMPLETE, router::GraphModel::LINEAR }) {
+                    router::RoutingSettings settings = MakeSettings(router::RouterType::DIJKSTRA);
+                    settings.graph_model = graph_model;
+                    std::unique_ptr<Base> base = MakeBase(network, settings);
+                    SaveBase(*base, path);
+                    std::unique_ptr<Base> loaded = LoadBase(path);
+                    AssertRoutesMatchFloyd(loaded->router, loaded->catalog, "edge columns"s);
+                    std::unique_ptr<Base> rebuilt = LoadBase(path, false);
+                    AssertRoutesMatchFloyd(rebuilt->router, rebuilt->catalog, "rebuilt graph"s);
+                }
+                std::filesystem::remove(path);
+            }
+
+            // the edges built on several threads get the same ids as on one, the bases are the same byte for byte
+            void TestParallelGraph() {
+                const TestNetwork network = MakeNetwork(7, 14);
+                const std::filesystem::path path = GetTemporaryPath("parallel_graph"s);
+                for (const router::GraphModel graph_model : { router::GraphModel::COMPLETE, router::GraphModel::LINEAR }) {
+                    std::string first_data;
+                    for (const size_t build_threads : { 1, 3, 8 }) {
+                        router::RoutingSettings settings = MakeSettings(router::RouterType::DIJKSTRA);
+                        settings.graph_model = graph_model;
+                        settings.build_threads = build_threads;
+                        std::unique_ptr<Base> base = MakeBase(network, settings);
+                        AssertRoutesMatchFloyd(base->router, base->catalog, std::to_string(build_threads) + " threads"s);
+                        SaveBase(*base, path);
+                        std::ifstream in(path, std::ios::binary);
+                        const std::string data{ std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>() };
+                        if (build_threads == 1) {
+                            first_data = data;
+                        }
+                        ASSERT_HINT(data == first_data, std::to_string(build_threads) + " threads"s);
+                    }
+                }
+                std::filesystem::remove(path);
+            }
+
+            // rounds over the buses with no preprocessing, also on several threads, read from a base and with buses added
+            void TestRaptorRouter() {
+                const TestNetwork network = MakeNetwork(6, 15);
+                const std::filesystem::path path = GetTemporaryPath("raptor"s);
+                router::RoutingSettings settings = MakeSettings(router::RouterType::RAPTOR);
+                settings.route_cache_size = 1;
+                std::unique_ptr<Base> base = MakeBase(network, settings);
+                std::vector<std::thread> threads;
+                for (int i = 0; i < 4; ++i) {
+                    threads.emplace_back([&base, i] {
+                        AssertRoutesMatchFloyd(base->router, base->catalog, "raptor, thread "s + std::to_string(i));
+                    });
+                }
+                for (std::thread& thread : threads) {
+                    thread.join();
+                }
+                const std::vector<const Stop*> stops = GetStops(base->catalog);
+                AssertTimesMatchFloyd(base->router, base->catalog, stops, stops, "raptor times"s);
+
+                SaveBase(*base, path);
+                std::unique_ptr<Base> loaded = LoadBase(path);
+                ASSERT(loaded->router.GetRouterType() == router::RouterType::RAPTOR);
+                AssertRoutesMatchFloyd(loaded->router, loaded->catalog, "loaded raptor"s);
+                std::filesystem::remove(path);
+
+                base = std::make_unique<Base>();
+                FillCatalog(base->catalog, network, 2);
+                base->router.SetSettings(MakeSettings(router::RouterType::RAPTOR));
+                base->router.CreateGraph();
+                for (size_t i = network.buses.size() - 2; i < network.buses.size(); ++i) {
+                    AddBus(base->catalog, network.buses[i]);
+                    base->router.AddBus(*base->catalog.GetBusInfo(network.buses[i].name));
+                    AssertRoutesMatchFloyd(base->router, base->catalog, "raptor, added "s + network.buses[i].name);
+                }
+            }
+
+            // whole ticks give the times of the doubles; a route or an edge longer than the ticks hold
+            // falls back to the double weights
+            void TestTicksMatrix() {
+                const std::filesystem::path path = GetTemporaryPath("ticks_matrix"s);
+                router::RoutingSettings settings = MakeSettings(router::RouterType::MATRIX);
+                settings.weight_type = router::WeightType::TICKS;
+                std::unique_ptr<Base> base = MakeBase(MakeNetwork(6, 16), settings);
+                ASSERT_EQUAL(base->router.GetRoutesMatrix()->weight_size, sizeof(router::Ticks));
+                AssertRoutesMatchFloyd(base->router, base->catalog, "ticks"s);
+                SaveBase(*base, path);
+                std::unique_ptr<Base> loaded = LoadBase(path);
+                ASSERT_EQUAL(loaded->router.GetRoutesMatrix()->weight_size, sizeof(router::Ticks));
+                AssertRoutesMatchFloyd(loaded->router, loaded->catalog, "loaded ticks"s);
+                std::filesystem::remove(path);
+
+                // a meter is 3 ticks at the test velocity, a wait 12000: a route along the chain of four segments
+                // does not fit into 32 bits, while every bus of one segment there and back does and the distance
+                // of every bus stays an int
+                const int LONG_DISTANCE = 400000000;
+                TestNetwork long_network;
+                for (char name = 'A'; name <= 'E'; ++name) {
+                    long_network.stops.push_back({ std::string(1, name), { 55.0 + 0.1 * (name - 'A'), 37.0 } });
+                }
+                long_network.distances = { { "A"s, "B"s, LONG_DISTANCE }, { "B"s, "C"s, LONG_DISTANCE },
+                                           { "C"s, "D"s, LONG_DISTANCE }, { "D"s, "E"s, LONG_DISTANCE } };
+                long_network.buses = { { "AB"s, { "A"s, "B"s }, false }, { "BC"s, { "B"s, "C"s }, false },
+                                       { "CD"s, { "C"s, "D"s }, false }, { "DE"s, { "D"s, "E"s }, false } };
+                base = MakeBase(long_network, settings);
+                ASSERT_EQUAL(base->router.GetRoutesMatrix()->weight_size, sizeof(double));
+                AssertRoutesMatchFloyd(base->router, base->catalog, "saturated route"s);
+                base = std::make_unique<Base>();
+                FillCatalog(base->catalog, long_network, 1);
+                base->router.SetSettings(router::RoutingSettings(settings));
+                base->router.CreateGraph();
+                ASSERT_EQUAL(base->router.GetRoutesMatrix()->weight_size, sizeof(router::Ticks));
+                AddBus(base->catalog, long_network.buses.back());
+                base->router.AddBus(*base->catalog.GetBusInfo(long_network.buses.back().name));
+                ASSERT_EQUAL(base->router.GetRoutesMatrix()->weight_size, sizeof(double));
+                AssertRoutesMatchFloyd(base->router, base->catalog, "saturated by an added bus"s);
+                // a ring of three segments with one wait keeps the ticks
+                long_network.distances.push_back({ "D"s, "A"s, 1 });
+                long_network.buses = { { "ABCD"s, { "A"s, "B"s, "C"s, "D"s, "A"s }, true } };
+                base = MakeBase(long_network, settings);
+                ASSERT_EQUAL(base->router.GetRoutesMatrix()->weight_size, sizeof(router::Ticks));
+                AssertRoutesMatchFloyd(base->router, base->catalog, "long ring"s);
+                // the edge from A to E along a ring of four
+                long_network.distances.push_back({ "E"s, "A"s, 1 });
+                long_network.buses = { { "ABCDE"s, { "A"s, "B"s, "C"s, "D"s, "E"s, "A"s }, true } };
+                base = MakeBase(long_network, settings);
+                ASSERT_EQUAL(base->router.GetRoutesMatrix()->weight_size, sizeof(double));
+                AssertRoutesMatchFloyd(base->router, base->catalog, "saturated edge"s);
+            }
+
+            // the reference relaxation: min(weight_from + weights_through[i], saturated) for every reached column
+            template <typename Weight>
+            void RelaxRowByElement(std::vector<Weight>& weights, std::vector<uint32_t>& prev_edges, Weight weight_from,
+                                   uint32_t prev_edge_from, const std::vector<Weight>& weights_through,
+                                   const std::vector<uint32_t>& prev_edges_through, uint32_t no_edge) {
+                for (size_t i = 0; i < weights.size(); ++i) {
+                    Weight candidate;
+                    if constexpr (std::is_integral_v<Weight>) {
+                        if (weights_through[i] == std::numeric_limits<Weight>::max()) {
+                            continue;
+                        }
+                        const uint64_t sum = uint64_t(weight_from) + weights_through[i];
+                        candidate = static_cast<Weight>(std::min<uint64_t>(sum, std::numeric_limits<Weight>::max() - 1));
+                    }
+                    else {
+                        candidate = weight_from + weights_through[i];
+                    }
+                    if (candidate < weights[i]) {
+                        weights[i] = candidate;
+                        prev_edges[i] = prev_edges_through[i] != no_edge ? prev_edges_through[i] : prev_edge_from;
+                    }
+                }
+            }
+
+            // the vector kernel of the CPU gives the weights and the edges of the reference, on rows of every length
+            // around the vector widths, with no routes, ties and sums near the saturation
+            template <typename Weight>
+            void TestRelaxRow(Weight unreachable, Weight max_weight) {
+                std::mt19937 generator(17);
+                const uint32_t NO_EDGE = std::numeric_limits<uint32_t>::max();
+                auto random_weight = [&](Weight weight_from) {
+                    switch (std::uniform_int_distribution<int>(0, 4)(generator)) {
+                    case 0:
+                        return unreachable;
+                    case 1:
+                        return static_cast<Weight>(max_weight - weight_from);
+                    default:
+                        return static_cast<Weight>(std::uniform_int_distribution<int>(0, 20)(generator));
+                    }
+                };
+                for (size_t count = 0; count < 40; ++count) {
+                    for (int round = 0; round < 20; ++round) {
+                        const Weight weight_from = round % 5 == 0
+                            ? static_cast<Weight>(max_weight - 5) : static_cast<Weight>(std::uniform_int_distribution<int>(0, 10)(generator));
+                        const uint32_t prev_edge_from = std::uniform_int_distribution<uint32_t>(0, 100)(generator);
+                        std::vector<Weight> weights(count);
+                        std::vector<Weight> weights_through(count);
+                        std::vector<uint32_t> prev_edges(count);
+                        std::vector<uint32_t> prev_edges_through(count);
+                        for (size_t i = 0; i < count; ++i) {
+                            weights[i] = random_weight(0);
+                            weights_through[i] = random_weight(weight_from);
+                            prev_edges[i] = std::uniform_int_distribution<uint32_t>(0, 100)(generator);
+                            prev_edges_through[i] = round % 2 == 0 ? NO_EDGE : std::uniform_int_distribution<uint32_t>(0, 100)(generator);
+                        }
+                        std::vector<Weight> expected_weights = weights;
+                        std::vector<uint32_t> expected_prev_edges = prev_edges;
+                        RelaxRowByElement(expected_weights, expected_prev_edges, weight_from, prev_edge_from,
+                                          weights_through, prev_edges_through, NO_EDGE);
+                        graph::min_plus::RelaxRow(weights.data(), prev_edges.data(), weight_from, prev_edge_from,
+                                                  weights_through.data(), prev_edges_through.data(), count, NO_EDGE);
+                        ASSERT_HINT(weights == expected_weights, std::to_string(count) + " columns"s);
+                        ASSERT_HINT(prev_edges == expected_prev_edges, std::to_string(count) + " columns"s);
+                    }
+                }
+            }
+
+            void TestMinPlusKernel() {
+                TestRelaxRow<double>(std::numeric_limits<double>::infinity(), 1e6);
+                TestRelaxRow<uint32_t>(std::numeric_limits<uint32_t>::max(), std::numeric_limits<uint32_t>::max() - 1);
+                // the kernel relaxes the rows of the matrix in both weight types
+                const TestNetwork network = MakeNetwork(11, 18);
+                for (const router::WeightType weight_type : { router::WeightType::DOUBLE, router::WeightType::TICKS }) {
+                    router::RoutingSettings settings = MakeSettings(router::RouterType::MATRIX);
+                    settings.weight_type = weight_type;
+                    std::unique_ptr<Base> base = MakeBase(network, settings);
+                    AssertRoutesMatchFloyd(base->router, base->catalog, weight_type == router::WeightType::TICKS ? "ticks"s : "double"s);
+                }
+            }
+
+            // the parts of the routes matrix built by separate catalogues make up the whole one; parts missing or
+            // overlapping rows and parts of other data are refused
+            void TestMergeBase() {
+                const TestNetwork network = MakeNetwork(6, 19);
+                const graph::VertexId vertex_count = static_cast<graph::VertexId>(network.stops.size() - 1);
+                auto save_part = [&network](graph::RowRange rows, const std::string& name, int bus_wait_time = TEST_WAIT_TIME) {
+                    Base base;
+                    FillCatalog(base.catalog, network);
+                    router::RoutingSettings settings = MakeSettings(router::RouterType::MATRIX);
+                    settings.bus_wait_time = bus_wait_time;
+                    base.router.SetSettings(std::move(settings));
+                    base.router.SetRowRange(rows);
+                    base.router.CreateGraph();
+                    SaveBase(base, GetTemporaryPath(name));
+                    return GetTemporaryPath(name);
+                };
+                auto merge = [](const std::vector<std::filesystem::path>& parts) {
+                    Base base;
+                    serialize::Serializator serializator(base.catalog, base.renderer, base.router);
+                    serializator.SetPathToSerialize(GetTemporaryPath("merged_base"s));
+                    serializator.Merge(parts);
+                };
+                auto is_refused = [&merge](const std::vector<std::filesystem::path>& parts) {
+                    try {
+                        merge(parts);
+                    }
+                    catch (const std::invalid_argument&) {
+                        return true;
+                    }
+                    return false;
+                };
+
+                const std::filesystem::path first = save_part({ 0, 10 }, "part_0"s);
+                const std::filesystem::path second = save_part({ 10, 25 }, "part_1"s);
+                const std::filesystem::path third = save_part({ 25, vertex_count }, "part_2"s);
+                merge({ third, first, second });
+                std::unique_ptr<Base> merged = LoadBase(GetTemporaryPath("merged_base"s));
+                AssertRoutesMatchFloyd(merged->router, merged->catalog, "merged base"s);
+
+                ASSERT_HINT(is_refused({ first, third }), "missing rows"s);
+                ASSERT_HINT(is_refused({ first, second }), "missing last rows"s);
+                const std::filesystem::path overlapping = save_part({ 5, 25 }, "part_3"s);
+                ASSERT_HINT(is_refused({ first, overlapping, third }), "overlapping rows"s);
+                ASSERT_HINT(is_refused({ first, second, third, third }), "repeated part"s);
+                const std::filesystem::path other_settings = save_part({ 10, 25 }, "part_4"s, TEST_WAIT_TIME + 1);
+                ASSERT_HINT(is_refused({ first, other_settings, third }), "other settings"s);
+                for (const std::string& name : { "part_0"s, "part_1"s, "part_2"s, "part_3"s, "part_4"s, "merged_base"s }) {
+                    std::filesystem::remove(GetTemporaryPath(name));
+                }
+            }
+
+            // the labels of both graph models give the routes and the times, also read from a base
+            void TestHubLabels() {
+                const TestNetwork network = MakeNetwork(7, 20);
+                const std::filesystem::path path = GetTemporaryPath("hub_labels"s);
+                for (const router::GraphModel graph_model : { router::GraphModel::COMPLETE, router::GraphModel::LINEAR }) {
+                    router::RoutingSettings settings = MakeSettings(router::RouterType::HUB_LABELS);
+                    settings.graph_model = graph_model;
+                    std::unique_ptr<Base> base = MakeBase(network, settings);
+                    AssertRoutesMatchFloyd(base->router, base->catalog, "hub labels"s);
+                    const std::vector<const Stop*> stops = GetStops(base->catalog);
+                    AssertTimesMatchFloyd(base->router, base->catalog, stops, stops, "hub labels times"s);
+                    SaveBase(*base, path);
+                    std::unique_ptr<Base> loaded = LoadBase(path);
+                    ASSERT(loaded->router.GetRouterType() == router::RouterType::HUB_LABELS);
+                    AssertRoutesMatchFloyd(loaded->router, loaded->catalog, "loaded hub labels"s);
+                    const std::vector<const Stop*> loaded_stops = GetStops(loaded->catalog);
+                    AssertTimesMatchFloyd(loaded->router, loaded->catalog, loaded_stops, loaded_stops, "loaded hub labels times"s);
+                }
+                std::filesystem::remove(path);
+            }
+
+            // the stops no bus serves, among the served ones by name and by the order of adding, get no vertex
+            // and no routes but the empty one to themselves, with every router
+            void TestBuslessStops() {
+                TestNetwork network = MakeNetwork(5, 21);
+                network.stops.insert(network.stops.begin(), { "A"s, { 55.5, 37.5 } });
+                network.stops.insert(network.stops.begin() + 10, { "S1_1a"s, { 55.61, 37.61 } });
+                network.stops.push_back({ "Z"s, { 55.7, 37.7 } });
+                network.distances.push_back({ "A"s, "S0_0"s, 500 });
+                const size_t served_count = network.stops.size() - 4;
+                const std::filesystem::path path = GetTemporaryPath("busless_stops"s);
+                for (const router::RouterType router_type : { router::RouterType::MATRIX, router::RouterType::DIJKSTRA,
+                                                              router::RouterType::CONTRACTION_HIERARCHY,
+                                                              router::RouterType::HUB_LABELS, router::RouterType::RAPTOR }) {
+                    const std::string hint = "router "s + std::to_string(static_cast<int>(router_type));
+                    std::unique_ptr<Base> base = MakeBase(network, MakeSettings(router_type));
+                    if (router_type == router::RouterType::MATRIX) {
+                        ASSERT_EQUAL(base->router.GetRoutesMatrix()->vertex_count, served_count);
+                    }
+                    AssertRoutesMatchFloyd(base->router, base->catalog, hint);
+                    const std::vector<const Stop*> stops = GetStops(base->catalog);
+                    AssertTimesMatchFloyd(base->router, base->catalog, stops, stops, hint + " times"s);
+                    SaveBase(*base, path);
+                    std::unique_ptr<Base> loaded = LoadBase(path);
+                    AssertRoutesMatchFloyd(loaded->router, loaded->catalog, "loaded "s + hint);
+                }
+                std::filesystem::remove(path);
+            }
+
+            // the grid and the island are separate blocks of the matrix with no routes between them; a bus joining
+            // them has the matrix computed again, one within a component updates it in place
+            void TestComponents() {
+                TestNetwork network = MakeNetwork(6, 22);
+                network.distances.push_back({ "S0_0"s, "Island 0"s, 5000 });
+                network.buses.push_back({ "Inner"s, { "S0_0"s, "S1_1"s }, false });
+                network.distances.push_back({ "S0_0"s, "S1_1"s, 1000 });
+                network.buses.push_back({ "Bridge"s, { "S0_0"s, "Island 0"s }, false });
+                const size_t grid_size = 6 * 6;
+                for (const router::WeightType weight_type : { router::WeightType::DOUBLE, router::WeightType::TICKS }) {
+                    router::RoutingSettings settings = MakeSettings(router::RouterType::MATRIX);
+                    settings.weight_type = weight_type;
+                    auto base = std::make_unique<Base>();
+                    FillCatalog(base->catalog, network, 2);
+                    base->router.SetSettings(std::move(settings));
+                    base->router.CreateGraph();
+                    const auto matrix = base->router.GetRoutesMatrix();
+                    size_t cell_count = 0;
+                    for (const router::RoutesSection::Cells& cells : matrix->cells) {
+                        cell_count += cells.count;
+                    }
+                    ASSERT_EQUAL(cell_count, grid_size * grid_size + 3 * 3);
+                    const Stop* grid_stop = *base->catalog.GetStopInfo("S0_0"s);
+                    const Stop* island_stop = *base->catalog.GetStopInfo("Island 0"s);
+                    ASSERT(!base->router.ComputeRoute(grid_stop, island_stop).has_value());
+                    ASSERT(!base->router.ComputeRoute(island_stop, grid_stop).has_value());
+                    ASSERT(!base->router.ComputeTimes({ grid_stop }, { island_stop })[0][0].has_value());
+                    AssertRoutesMatchFloyd(base->router, base->catalog, "components"s);
+
+                    for (size_t i = network.buses.size() - 2; i < network.buses.size(); ++i) {
+                        AddBus(base->catalog, network.buses[i]);
+                        base->router.AddBus(*base->catalog.GetBusInfo(network.buses[i].name));
+                        AssertRoutesMatchFloyd(base->router, base->catalog, "added "s + network.buses[i].name);
+                        ASSERT_EQUAL(base->router.GetMatrixRebuildCount(), i + 2 - network.buses.size());
+                    }
+                    ASSERT(base->router.ComputeRoute(island_stop, grid_stop).has_value());
+                }
+            }
+
+            // the stops numbered along the Hilbert curve, with both graph models, read from a base and with buses added
+            void TestHilbertOrder() {
+                const TestNetwork network = MakeNetwork(7, 23);
+                const std::filesystem::path path = GetTemporaryPath("hilbert_order"s);
+                for (const router::RouterType router_type : { router::RouterType::MATRIX, router::RouterType::DIJKSTRA }) {
+                    for (const router::GraphModel graph_model : { router::GraphModel::COMPLETE, router::GraphModel::LINEAR }) {
+                        router::RoutingSettings settings = MakeSettings(router_type);
+                        settings.graph_model = graph_model;
+                        settings.vertex_order = router::VertexOrder::HILBERT;
+                        std::unique_ptr<Base> base = MakeBase(network, settings);
+                        AssertRoutesMatchFloyd(base->router, base->catalog, "hilbert order"s);
+                        SaveBase(*base, path);
+                        std::unique_ptr<Base> loaded = LoadBase(path);
+                        AssertRoutesMatchFloyd(loaded->router, loaded->catalog, "loaded hilbert order"s);
+
+                        base = std::make_unique<Base>();
+                        FillCatalog(base->catalog, network, 2);
+                        base->router.SetSettings(std::move(settings));
+                        base->router.CreateGraph();
+                        for (size_t i = network.buses.size() - 2; i < network.buses.size(); ++i) {
+                            AddBus(base->catalog, network.buses[i]);
+                            base->router.AddBus(*base->catalog.GetBusInfo(network.buses[i].name));
+                            AssertRoutesMatchFloyd(base->router, base->catalog, "hilbert order, added "s + network.buses[i].name);
+                        }
+                    }
+                }
+                std::filesystem::remove(path);
+
+                router::RoutingSettings settings = MakeSettings(router::RouterType::DIJKSTRA);
+                settings.vertex_order = router::VertexOrder::HILBERT;
+                const auto hilbert_vertices = MakeBase(network, settings)->router.Serialize().stop_vertices();
+                const auto catalogue_vertices = MakeBase(network, MakeSettings(router::RouterType::DIJKSTRA))->router.Serialize().stop_vertices();
+                ASSERT(!std::equal(hilbert_vertices.begin(), hilbert_vertices.end(), catalogue_vertices.begin(), catalogue_vertices.end()));
+            }
+
+            // the routes over the graph with one edge per vertex pair take the same times and are made of real rides;
+            // a bus added over the same stops as an existing one has all its edges pruned
+            void TestParallelEdgePruning() {
+                TestNetwork network = MakeNetwork(6, 24);
+                TestBus copy = network.buses.front();
+                copy.name = "R0 copy"s;
+                network.buses.push_back(copy);
+                network.buses.push_back({ "R0 part"s, { "S0_1"s, "S0_2"s, "S0_3"s }, false });
+                const std::filesystem::path path = GetTemporaryPath("parallel_edge_pruning"s);
+                for (const router::RouterType router_type : { router::RouterType::MATRIX, router::RouterType::DIJKSTRA,
+                                                              router::RouterType::CONTRACTION_HIERARCHY }) {
+                    router::RoutingSettings settings = MakeSettings(router_type);
+                    settings.prune_parallel_edges = true;
+                    std::unique_ptr<Base> base = MakeBase(network, settings);
+                    ASSERT(base->router.GetPrunedEdgeCount() > 0);
+                    AssertRoutesMatchFloyd(base->router, base->catalog, "pruned edges"s);
+                    SaveBase(*base, path);
+                    std::unique_ptr<Base> loaded = LoadBase(path);
+                    AssertRoutesMatchFloyd(loaded->router, loaded->catalog, "loaded pruned edges"s);
+
+                    base = std::make_unique<Base>();
+                    FillCatalog(base->catalog, network, 2);
+                    base->router.SetSettings(std::move(settings));
+                    base->router.CreateGraph();
+                    const size_t pruned_count = base->router.GetPrunedEdgeCount();
+                    const int edge_count = base->router.Serialize(true).graph().edge_from_size();
+                    AddBus(base->catalog, copy);
+                    base->router.AddBus(*base->catalog.GetBusInfo(copy.name));
+                    ASSERT(base->router.GetPrunedEdgeCount() > pruned_count);
+                    ASSERT_EQUAL(base->router.Serialize(true).graph().edge_from_size(), edge_count);
+                    AssertRoutesMatchFloyd(base->router, base->catalog, "pruned edges, added a copy"s);
+                    AddBus(base->catalog, network.buses.back());
+                    base->router.AddBus(*base->catalog.GetBusInfo(network.buses.back().name));
+                    AssertRoutesMatchFloyd(base->router, base->catalog, "pruned edges, added a part"s);
+                }
+                std::filesystem::remove(path);
+            }
+
+            // the routes matrix computed by batches of a few rows and written out right away reads back as the one
+            // kept in memory; ticks too small for a route have the base written again in doubles
+            void TestStreamedMatrix() {
+                const TestNetwork network = MakeNetwork(7, 25);
+                const std::filesystem::path path = GetTemporaryPath("streamed_matrix"s);
+                auto save_streamed = [&path](const TestNetwork& streamed_network, router::RoutingSettings settings, size_t budget) {
+                    Base base;
+                    FillCatalog(base.catalog, streamed_network);
+                    base.router.SetSettings(std::move(settings));
+                    base.router.SetMatrixMemoryBudget(budget);
+                    base.router.CreateGraph();
+                    ASSERT(base.router.IsMatrixStreamed());
+                    SaveBase(base, path);
+                    return LoadBase(path);
+                };
+                for (const router::WeightType weight_type : { router::WeightType::DOUBLE, router::WeightType::TICKS }) {
+                    for (const size_t budget : { size_t(1), size_t(1000), size_t(1) << 20 }) {
+                        router::RoutingSettings settings = MakeSettings(router::RouterType::MATRIX);
+                        settings.weight_type = weight_type;
+                        settings.build_threads = 2;
+                        std::unique_ptr<Base> loaded = save_streamed(network, std::move(settings), budget);
+                        AssertRoutesMatchFloyd(loaded->router, loaded->catalog, std::to_string(budget) + " bytes"s);
+                    }
+                }
+
+                // a route along the chain is more than 2^32 ticks, see TestTicksMatrix
+                const int LONG_DISTANCE = 400000000;
+                TestNetwork long_network;
+                for (char name = 'A'; name <= 'E'; ++name) {
+                    long_network.stops.push_back({ std::string(1, name), { 55.0 + 0.1 * (name - 'A'), 37.0 } });
+                }
+                long_network.distances = { { "A"s, "B"s, LONG_DISTANCE }, { "B"s, "C"s, LONG_DISTANCE },
+                                           { "C"s, "D"s, LONG_DISTANCE }, { "D"s, "E"s, LONG_DISTANCE } };
+                long_network.buses = { { "AB"s, { "A"s, "B"s }, false }, { "BC"s, { "B"s, "C"s }, false },
+                                       { "CD"s, { "C"s, "D"s }, false }, { "DE"s, { "D"s, "E"s }, false } };
+                router::RoutingSettings settings = MakeSettings(router::RouterType::MATRIX);
+                settings.weight_type = router::WeightType::TICKS;
+                std::unique_ptr<Base> loaded = save_streamed(long_network, std::move(settings), 1);
+                ASSERT_EQUAL(loaded->router.GetRoutesMatrix()->weight_size, sizeof(double));
+                AssertRoutesMatchFloyd(loaded->router, loaded->catalog, "saturated route"s);
+                std::filesystem::remove(path);
+            }
+
+            // a profile routes as a base built with its wait and velocity, whatever the router, the graph model and
+            // the pruning, when read from a base and with buses added
+            void TestRoutingProfiles() {
+                const TestNetwork network = MakeNetwork(6, 26);
+                const std::vector<router::RoutingProfile> profiles = { { "fast"s, 2, 65 }, { "slow"s, 11, 17 } };
+                const std::filesystem::path path = GetTemporaryPath("routing_profiles"s);
+                for (const router::RouterType router_type : { router::RouterType::MATRIX, router::RouterType::DIJKSTRA,
+                                                              router::RouterType::CONTRACTION_HIERARCHY,
+                                                              router::RouterType::HUB_LABELS, router::RouterType::RAPTOR }) {
+                    for (const router::GraphModel graph_model : { router::GraphModel::COMPLETE, router::GraphModel::LINEAR }) {
+                        const std::string hint = "router "s + std::to_string(static_cast<int>(router_type))
+                            + (graph_model == router::GraphModel::LINEAR ? ", linear"s : ""s);
+                        router::RoutingSettings settings = MakeSettings(router_type);
+                        settings.graph_model = graph_model;
+                        settings.prune_parallel_edges = graph_model == router::GraphModel::COMPLETE;
+                        settings.profiles = profiles;
+                        std::unique_ptr<Base> base = MakeBase(network, settings);
+                        SaveBase(*base, path);
+                        std::unique_ptr<Base> loaded = LoadBase(path);
+                        auto updated = std::make_unique<Base>();
+                        FillCatalog(updated->catalog, network, 2);
+                        updated->router.SetSettings(router::RoutingSettings(settings));
+                        updated->router.CreateGraph();
+                        for (size_t i = network.buses.size() - 2; i < network.buses.size(); ++i) {
+                            AddBus(updated->catalog, network.buses[i]);
+                            updated->router.AddBus(*updated->catalog.GetBusInfo(network.buses[i].name));
+                        }
+
+                        for (const router::RoutingProfile& profile : profiles) {
+                            router::RoutingSettings profile_settings = settings;
+                            profile_settings.bus_wait_time = profile.bus_wait_time;
+                            profile_settings.bus_velocity = profile.bus_velocity;
+                            profile_settings.profiles.clear();
+                            std::unique_ptr<Base> profile_base = MakeBase(network, profile_settings);
+                            const std::vector<const Stop*> stops = GetStops(base->catalog);
+                            const std::vector<const Stop*> profile_stops = GetStops(profile_base->catalog);
+                            ASSERT_HINT(base->router.GetProfile(profile.name).ComputeTimes(stops, stops)
+                                        == profile_base->router.ComputeTimes(profile_stops, profile_stops), hint + ", "s + profile.name);
+                            AssertRoutesMatchFloyd(base->router.GetProfile(profile.name), base->catalog,
+                                                   hint + ", "s + profile.name, profile.bus_wait_time, profile.bus_velocity);
+                            ASSERT_HINT(loaded->router.GetProfile(profile.name).ComputeTimes(stops, stops)
+                                        == profile_base->router.ComputeTimes(profile_stops, profile_stops), hint + ", loaded "s + profile.name);
+                            AssertRoutesMatchFloyd(loaded->router.GetProfile(profile.name), loaded->catalog,
+                                                   hint + ", loaded "s + profile.name, profile.bus_wait_time, profile.bus_velocity);
+                            AssertRoutesMatchFloyd(updated->router.GetProfile(profile.name), updated->catalog,
+                                                   hint + ", updated "s + profile.name, profile.bus_wait_time, profile.bus_velocity);
+                        }
+                        AssertRoutesMatchFloyd(base->router, base->catalog, hint);
+                    }
+                }
+                std::filesystem::remove(path);
+
+                // a request for an unknown profile is answered as not found, the others go on
+                json::Dict json_settings = MakeJsonSettings("matrix"s);
+                json_settings["profiles"s] = json::Dict{ { "fast"s, json::Dict{ { "bus_velocity"s, 65 } } } };
+                const json::Array requests = {
+                    json::Dict{ { "id"s, 1 }, { "type"s, "Route"s }, { "from"s, "S0_0"s }, { "to"s, "S5_5"s }, { "profile"s, "fast"s } },
+                    json::Dict{ { "id"s, 2 }, { "type"s, "Route"s }, { "from"s, "S0_0"s }, { "to"s, "S5_5"s }, { "profile"s, "rush"s } },
+                    json::Dict{ { "id"s, 3 }, { "type"s, "Matrix"s }, { "from"s, json::Array{ "S0_0"s } },
+                                { "to"s, json::Array{ "S5_5"s } }, { "profile"s, "rush"s } },
+                    json::Dict{ { "id"s, 4 }, { "type"s, "Route"s }, { "from"s, "S0_0"s }, { "to"s, "S5_5"s } } };
+                json::Array answers = ProcessRequests(network, json_settings, requests);
+                ASSERT_EQUAL(answers.size(), 4u);
+                ASSERT(answers[0].AsMap().count("total_time"s));
+                ASSERT_EQUAL(answers[1].AsMap().at("error_message"s).AsString(), "not found"s);
+                ASSERT_EQUAL(answers[2].AsMap().at("error_message"s).AsString(), "not found"s);
+                ASSERT(answers[3].AsMap().count("total_time"s));
+                ASSERT(answers[0].AsMap().at("total_time"s).AsDouble() < answers[3].AsMap().at("total_time"s).AsDouble());
+            }
+
+            // the stops of an isochrone are those Floyd-Warshall gets to within the time, with its times, nearest first
+            void AssertIsochroneMatchesFloyd(const router::TransportRouter& router, const aggregations::TransportCatalogue& catalog,
+                                             const std::string& hint) {
+                const std::vector<std::vector<double>> floyd_times = ComputeFloydTimes(catalog);
+                for (const Stop* from : GetStops(catalog)) {
+                    for (const double max_time : { 0.0, 8.0, 20.0, 1e18 }) {
+                        const std::string isochrone_hint = hint + ": "s + from->name + " in "s + std::to_string(max_time);
+                        const std::vector<std::pair<const Stop*, double>> isochrone = router.ComputeIsochrone(from, max_time);
+                        size_t expected_count = 0;
+                        for (const Stop* to : GetStops(catalog)) {
+                            expected_count += floyd_times[from->vertex_id][to->vertex_id] <= max_time ? 1 : 0;
+                        }
+                        ASSERT_EQUAL_HINT(isochrone.size(), expected_count, isochrone_hint);
+                        for (size_t i = 0; i < isochrone.size(); ++i) {
+                            const auto& [stop, time] = isochrone[i];
+                            ASSERT_HINT(IsSameTime(time, floyd_times[from->vertex_id][stop->vertex_id]), isochrone_hint + " -> "s + stop->name);
+                            ASSERT_HINT(i == 0 || isochrone[i - 1].second <= time, isochrone_hint);
+                        }
+                        ASSERT_HINT(isochrone.front().first == from, isochrone_hint);
+                    }
+                }
+            }
+
+            // every router and graph model, the base read back and the json requests give the isochrones of Floyd-Warshall;
+            // a stop no bus serves reaches only itself
+            void TestIsochrone() {
+                const TestNetwork network = MakeNetwork(6, 27);
+                const std::filesystem::path path = GetTemporaryPath("isochrone"s);
+                const std::vector<std::tuple<router::RouterType, router::WeightType, router::GoalDirection>> routers = {
+                    { router::RouterType::MATRIX, router::WeightType::DOUBLE, router::GoalDirection::NONE },
+                    { router::RouterType::MATRIX, router::WeightType::TICKS, router::GoalDirection::NONE },
+                    { router::RouterType::DIJKSTRA, router::WeightType::DOUBLE, router::GoalDirection::NONE },
+                    { router::RouterType::DIJKSTRA, router::WeightType::DOUBLE, router::GoalDirection::GEO },
+                    { router::RouterType::CONTRACTION_HIERARCHY, router::WeightType::DOUBLE, router::GoalDirection::NONE },
+                    { router::RouterType::HUB_LABELS, router::WeightType::DOUBLE, router::GoalDirection::NONE },
+                    { router::RouterType::RAPTOR, router::WeightType::DOUBLE, router::GoalDirection::NONE },
+                };
+                for (const auto& [router_type, weight_type, goal_direction] : routers) {
+                    for (const router::GraphModel graph_model : { router::GraphModel::COMPLETE, router::GraphModel::LINEAR }) {
+                        const std::string hint = "router "s + std::to_string(static_cast<int>(router_type))
+                            + (weight_type == router::WeightType::TICKS ? ", ticks"s : ""s)
+                            + (goal_direction == router::GoalDirection::GEO ? ", geo"s : ""s)
+                            + (graph_model == router::GraphModel::LINEAR ? ", linear"s : ""s);
+                        router::RoutingSettings settings = MakeSettings(router_type);
+                        settings.weight_type = weight_type;
+                        settings.goal_direction = goal_direction;
+                        settings.graph_model = graph_model;
+                        std::unique_ptr<Base> base = MakeBase(network, settings);
+                        AssertIsochroneMatchesFloyd(base->router, base->catalog, hint);
+                        const Stop* lonely = *base->catalog.GetStopInfo("Lonely"s);
+                        ASSERT_HINT((base->router.ComputeIsochrone(lonely, 1e18)
+                                     == std::vector<std::pair<const Stop*, double>>{ { lonely, 0.0 } }), hint);
+                        SaveBase(*base, path);
+                        std::unique_ptr<Base> loaded = LoadBase(path);
+                        AssertIsochroneMatchesFloyd(loaded->router, loaded->catalog, hint + ", loaded"s);
+                    }
+                }
+                std::filesystem::remove(path);
+
+                json::Array answers = ProcessRequests(network, MakeJsonSettings("matrix"s),
+                    { json::Dict{ { "id"s, 1 }, { "type"s, "Isochrone"s }, { "from"s, "S2_3"s }, { "max_time"s, 20.0 } },
+                      json::Dict{ { "id"s, 2 }, { "type"s, "Isochrone"s }, { "from"s, "S2_3"s }, { "max_time"s, 20.0 },
+                                  { "profile"s, "rush"s } } });
+                aggregations::TransportCatalogue catalog;
+                FillCatalog(catalog, network);
+                const std::vector<std::vector<double>> floyd_times = ComputeFloydTimes(catalog);
+                const size_t from = (*catalog.GetStopInfo("S2_3"s))->vertex_id;
+                ASSERT_EQUAL(answers.size(), 2u);
+                ASSERT_EQUAL(answers[0].AsMap().at("request_id"s).AsInt(), 1);
+                ASSERT_EQUAL(answers[1].AsMap().at("error_message"s).AsString(), "not found"s);
+                json::Array& stops = answers[0].AsMap().at("stops"s).AsArray();
+                size_t expected_count = 0;
+                for (const Stop* to : GetStops(catalog)) {
+                    expected_count += floyd_times[from][to->vertex_id] <= 20.0 ? 1 : 0;
+                }
+                ASSERT_EQUAL(stops.size(), expected_count);
+                for (json::Node& stop : stops) {
+                    const std::string& name = stop.AsMap().at("stop_name"s).AsString();
+                    ASSERT_HINT(IsSameTime(stop.AsMap().at("time"s).AsDouble(),
+                                           floyd_times[from][(*catalog.GetStopInfo(name))->vertex_id]), name);
+                }
+            }
+        }
+
+        void TestRouters() {
+            RUN_UNIT_TEST(TestDijkstraRouter);
+            RUN_UNIT_TEST(TestConcurrentQueries);
+            RUN_UNIT_TEST(TestParallelMatrix);
+            RUN_UNIT_TEST(TestContractionHierarchy);
+            RUN_UNIT_TEST(TestLinearGraph);
+            RUN_UNIT_TEST(TestCompressedGraph);
+            RUN_UNIT_TEST(TestMatrixRequest);
+            RUN_UNIT_TEST(TestRoutesCache);
+            RUN_UNIT_TEST(TestAddBus);
+            RUN_UNIT_TEST(TestGoalDirection);
+            RUN_UNIT_TEST(TestBaseVersions);
+            RUN_UNIT_TEST(TestGraphColumns);
+            RUN_UNIT_TEST(TestParallelGraph);
+            RUN_UNIT_TEST(TestRaptorRouter);
+            RUN_UNIT_TEST(TestTicksMatrix);
+            RUN_UNIT_TEST(TestMinPlusKernel);
+            RUN_UNIT_TEST(TestMergeBase);
+            RUN_UNIT_TEST(TestHubLabels);
+            RUN_UNIT_TEST(TestBuslessStops);
+            RUN_UNIT_TEST(TestComponents);
+            RUN_UNIT_TEST(TestHilbertOrder);
+            RUN_UNIT_TEST(TestParallelEdgePruning);
+            RUN_UNIT_TEST(TestStreamedMatrix);
+            RUN_UNIT_TEST(TestRoutingProfiles);
+            RUN_UNIT_TEST(TestIsochrone);
+        }
+    }       // namespace tests
+}           // namespace tr_cat
+
+int main() {
+    tr_cat::tests::TestRouters();
+}
@@ -0,0 +1,92 @@
+#include <algorithm>
+
+#include "thread_pool.h"
+
+namespace concurrency {
+    ThreadPool::ThreadPool(size_t thread_count) {
+        if (thread_count == 0) {
+            thread_count = std::max(1u, std::thread::hardware_concurrency());
+        }
+        workers_.reserve(thread_count - 1);
+        for (size_t i = 1; i < thread_count; ++i) {
+            workers_.emplace_back([this] { WorkerLoop(); });
+        }
+    }
+
+    ThreadPool::~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        task_ready_.notify_all();
+        for (std::thread& worker : workers_) {
+            worker.join();
+        }
+    }
+
+    void ThreadPool::ParallelFor(size_t count, const std::function<void(size_t)>& task) {
+        if (count == 0) {
+            return;
+        }
+        std::unique_lock<std::mutex> lock(mutex_);
+        task_ = &task;
+        task_size_ = count;
+        next_index_ = 0;
+        error_ = nullptr;
+        ++generation_;
+        task_ready_.notify_all();
+
+        RunTasks(lock);
+        task_done_.wait(lock, [this] { return active_workers_ == 0; });
+        task_ = nullptr;
+        if (error_) {
+            std::rethrow_exception(error_);
+        }
+    }
+
+    void ThreadPool::WorkerLoop() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        size_t seen_generation = generation_;
+        while (true) {
+            task_ready_.wait(lock, [&] { return stopping_ || (task_ && generation_ != seen_generation); });
+            if (stopping_) {
+                return;
+            }
+            seen_generation = generation_;
+            RunTasks(lock);
+        }
+    }
+
+    void ThreadPool::RunTasks(std::unique_lock<std::mutex>& lock) {
+        ++active_workers_;
+        while (next_index_ < task_size_ && !error_) {
+            const size_t index = next_index_++;
+            const std::function<void(size_t)>& task = *task_;
+            lock.unlock();
+            try {
+                task(index);
+            }
+            catch (...) {
+                lock.lock();
+                if (!error_) {
+                    error_ = std::current_exception();
+                }
+                continue;
+            }
+            lock.lock();
+        }
+        if (--active_workers_ == 0) {
+            task_done_.notify_all();
+        }
+    }
+
+    void ParallelFor(ThreadPool* pool, size_t count, const std::function<void(size_t)>& task) {
+        if (pool) {
+            pool->ParallelFor(count, task);
+            return;
+        }
+        for (size_t index = 0; index < count; ++index) {
+            task(index);
+        }
+    }
+}       // namespace concurrency
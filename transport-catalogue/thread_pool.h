@@ -0,0 +1,47 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdlib>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace concurrency {
+    // a fixed set of worker threads that split index ranges between them
+    class ThreadPool {
+    private:        // fields
+        std::vector<std::thread> workers_;
+        std::mutex mutex_;
+        std::condition_variable task_ready_;
+        std::condition_variable task_done_;
+        const std::function<void(size_t)>* task_ = nullptr;
+        size_t task_size_ = 0;
+        size_t next_index_ = 0;
+        size_t active_workers_ = 0;
+        size_t generation_ = 0;
+        std::exception_ptr error_;
+        bool stopping_ = false;
+
+    public:         // constructors
+        // thread_count == 0 means one thread per hardware core
+        explicit ThreadPool(size_t thread_count = 0);
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+        ~ThreadPool();
+
+    public:         // methods
+        size_t GetThreadCount() const { return workers_.size() + 1; }
+        // calls task(index) for every index in [0, count) and waits for all of them,
+        // the calling thread takes part in the work; the first thrown exception is rethrown
+        void ParallelFor(size_t count, const std::function<void(size_t)>& task);
+
+    private:        // methods
+        void WorkerLoop();
+        void RunTasks(std::unique_lock<std::mutex>& lock);
+    };
+
+    // runs the loop on the pool or, without one, on the calling thread
+    void ParallelFor(ThreadPool* pool, size_t count, const std::function<void(size_t)>& task);
+}       // namespace concurrency
@@ -134,6 +134,11 @@ namespace tr_cat {
                                 distance_list.add_distance();
                                 *distance_list.mutable_distance(distance_list.distance_size() - 1) = distance_to_out;
             }
+            // the hash map order follows the stop addresses, the bases of the same input have to be the same byte for byte
+            std::sort(distance_list.mutable_distance()->begin(), distance_list.mutable_distance()->end(),
+                [](const transport_catalog_serialize::Distance& lhs, const transport_catalog_serialize::Distance& rhs) {
+                    return std::pair(lhs.index_from(), lhs.index_to()) < std::pair(rhs.index_from(), rhs.index_to());
+                });
             transport_catalog_serialize::Catalog catalog;
             *catalog.mutable_bus_list() = bus_list;
             *catalog.mutable_stop_list() = stop_list;
@@ -6,6 +6,7 @@
 #include <unordered_map>
 #include <filesystem>
 #include <fstream>
+#include <optional>
 
 #include <transport_catalogue.pb.h>
 
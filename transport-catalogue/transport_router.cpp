@@ -1,11 +1,135 @@
+#include <algorithm>
+#include <iterator>
+#include <numeric>
+#include <tuple>
+
 #include "transport_router.h"
 
 namespace tr_cat {
     namespace router {
         using namespace std::string_literals;
 
-        std::optional<CompletedRoute> TransportRouter::ComputeRoute(graph::VertexId from, graph::VertexId to) {
-            std::optional<graph::Router<double>::RouteInfo> getted_route = router_->BuildRoute(from, to);
+        namespace {
+            // of two parallel edges the faster one, of the bus with the smaller name on a tie,
+            // so a route does not depend on the order the buses come in
+            bool IsPreferredEdge(const graph::Edge<double>& edge, const EdgeInfo& info,
+                                 const graph::Edge<double>& other, const EdgeInfo& other_info) {
+                if (edge.weight != other.weight) {
+                    return edge.weight < other.weight;
+                }
+                return info.bus && other_info.bus && info.bus->name < other_info.bus->name;
+            }
+
+            template <typename Weight>
+            RoutesSection MakeRoutesSection(const graph::Router<Weight>& matrix) {
+                const graph::RowRange rows = matrix.GetRowRange();
+                return { matrix.GetVertexCount(), rows, sizeof(Weight),
+                         { { matrix.GetWeights(), matrix.GetPrevEdges(), (rows.end - rows.begin) * matrix.GetVertexCount() } },
+                         nullptr };
+            }
+
+            template <typename Weight>
+            RoutesSection MakeRoutesSection(const graph::ComponentRouter<Weight>& matrix, size_t vertex_count) {
+                RoutesSection section{ vertex_count, { 0, vertex_count }, sizeof(Weight), {}, nullptr };
+                for (const auto& block : matrix.GetBlocks()) {
+                    section.cells.push_back({ block.weights, block.prev_edges, block.cell_count });
+                }
+                return section;
+            }
+
+            // every batch holds as many whole rows as fit into memory_budget, at least one
+            template <typename Weight>
+            void StreamRows(const graph::DirectedWeightedGraph<Weight>& graph, graph::RowRange rows, size_t memory_budget,
+                            size_t build_threads, const std::function<void(const RoutesSection&)>& write_rows) {
+                const size_t row_memory = graph.GetVertexCount() * (sizeof(Weight) + sizeof(RoutesSection::PrevEdge));
+                const size_t batch_rows = std::max<size_t>(1, memory_budget / std::max<size_t>(1, row_memory));
+                concurrency::ThreadPool pool(build_threads);
+                for (size_t begin = rows.begin; begin < rows.end; begin += batch_rows) {
+                    const graph::Router<Weight> batch(graph, { begin, std::min<size_t>(rows.end, begin + batch_rows) }, &pool);
+                    write_rows(MakeRoutesSection(batch));
+                }
+            }
+
+            // the index-th of count equal parts of a matrix read from a base
+            RoutesSection SliceRoutesSection(const RoutesSection& section, size_t index, size_t count) {
+                if (section.cells.size() != 1 || section.cells.front().count % count != 0) {
+                    throw std::invalid_argument("Routes matrix does not match the routing profiles"s);
+                }
+                const size_t cell_count = section.cells.front().count / count;
+                const size_t first_cell = index * cell_count;
+                return { section.vertex_count, section.rows, section.weight_size,
+                         { { static_cast<const char*>(section.cells.front().weights) + first_cell * section.weight_size,
+                             section.cells.front().prev_edges + first_cell, cell_count } },
+                         section.storage };
+            }
+
+            template <typename Weight>
+            typename graph::ComponentRouter<Weight>::BlocksView MakeBlocksView(RoutesSection section) {
+                if (section.weight_size != sizeof(Weight) || section.cells.size() != 1) {
+                    throw std::invalid_argument("Routes matrix does not match the routing settings"s);
+                }
+                if (section.rows.begin != 0 || section.rows.end != section.vertex_count) {
+                    throw std::invalid_argument("Base holds a part of the routes matrix, merge the parts first"s);
+                }
+                const RoutesSection::Cells& cells = section.cells.front();
+                return { cells.count, static_cast<const Weight*>(cells.weights), cells.prev_edges, std::move(section.storage) };
+            }
+        }
+
+        // the weights are computed from the edge infos of the base as if the graph was built with the profile
+        TransportRouter::TransportRouter(const TransportRouter& base, const RoutingProfile& profile)
+            : routing_settings_(base.routing_settings_)
+            , graph_(base.graph_.GetVertexCount())
+            , catalog_(base.catalog_)
+            , stop_vertices_(base.stop_vertices_)
+            , vertex_stops_(base.vertex_stops_)
+            , stop_vertex_count_(base.stop_vertex_count_)
+            , base_(&base) {
+            routing_settings_.bus_wait_time = profile.bus_wait_time;
+            routing_settings_.bus_velocity = profile.bus_velocity;
+            routing_settings_.profiles.clear();
+            graph_.ReserveEdges(base.graph_.GetEdgeCount());
+            AddBaseEdges(0);
+        }
+
+        TransportRouter& TransportRouter::GetProfile(std::string_view name) {
+            if (name.empty()) {
+                return *this;
+            }
+            for (size_t i = 0; i < profiles_.size(); ++i) {
+                if (routing_settings_.profiles[i].name == name) {
+                    return *profiles_[i];
+                }
+            }
+            throw std::invalid_argument("Unknown routing profile "s + std::string(name));
+        }
+
+        bool TransportRouter::HasProfile(std::string_view name) const {
+            return name.empty() || std::any_of(routing_settings_.profiles.begin(), routing_settings_.profiles.end(),
+                [name](const RoutingProfile& profile) { return profile.name == name; });
+        }
+
+        std::optional<CompletedRoute> TransportRouter::ComputeRoute(const Stop* from_stop, const Stop* to_stop) {
+            const graph::VertexId from = GetStopVertex(from_stop);
+            const graph::VertexId to = GetStopVertex(to_stop);
+            if (from == NO_VERTEX || to == NO_VERTEX) {
+                if (from_stop == to_stop) {
+                    return CompletedRoute({ 0, {} });
+                }
+                return std::nullopt;
+            }
+            const VertexPair key{ from, to };
+            if (std::shared_ptr<const std::optional<CompletedRoute>> route = routes_cache_->Get(key)) {
+                return *route;
+            }
+            return *routes_cache_->Put(key, BuildCompletedRoute(from, to));
+        }
+
+        std::optional<CompletedRoute> TransportRouter::BuildCompletedRoute(graph::VertexId from, graph::VertexId to) const {
+            if (raptor_) {
+                return BuildRaptorRoute(from, to);
+            }
+            std::optional<graph::RouterInterface<double>::RouteInfo> getted_route = router_->BuildRoute(from, to);
             if (!getted_route) {
                 return std::nullopt;
             }
@@ -16,14 +140,127 @@ namespace tr_cat {
             result.total_time = getted_route->weight;
             result.route.reserve(getted_route->edges.size());
             for (auto& edge : getted_route->edges) {
-                EdgeInfo& info = edges_.at(edge);
-                result.route.push_back(CompletedRoute::Line{ info.stop,
-                                                            info.bus,
+                const EdgeInfo& info = GetEdgeInfos()[edge];
+                if (!info.bus) {
+                    continue;
+                }
+                double run_time = graph_.GetEdge(edge).weight;
+                if (info.stop) {
+                    result.route.push_back(CompletedRoute::Line{ info.stop,
+                                                                info.bus,
+                                                                double(routing_settings_.bus_wait_time),
+                                                                0,
+                                                                0 });
+                    run_time -= routing_settings_.bus_wait_time;
+                }
+                result.route.back().run_time += run_time;
+                result.route.back().count_stops += info.count;
+            }
+            return result;
+        }
+
+        std::optional<CompletedRoute> TransportRouter::BuildRaptorRoute(graph::VertexId from, graph::VertexId to) const {
+            std::optional<RaptorRouter::Journey> journey = raptor_->FindJourney(from, to);
+            if (!journey) {
+                return std::nullopt;
+            }
+            if (journey->total_time < INNACURACY) {
+                return CompletedRoute({ 0, {} });
+            }
+            CompletedRoute result;
+            result.total_time = journey->total_time;
+            result.route.reserve(journey->rides.size());
+            for (const RaptorRouter::Ride& ride : journey->rides) {
+                result.route.push_back(CompletedRoute::Line{ ride.bus->stops[ride.board],
+                                                            ride.bus,
                                                             double(routing_settings_.bus_wait_time),
-                                                            graph_.GetEdge(edge).weight - routing_settings_.bus_wait_time,
-                                                            info.count });
+                                                            ride.time - routing_settings_.bus_wait_time,
+                                                            static_cast<int>(ride.alight - ride.board) });
+            }
+            return result;
+        }
+
+        std::vector<std::vector<std::optional<double>>> TransportRouter::ComputeTimes(const std::vector<const Stop*>& from,
+                                                                                       const std::vector<const Stop*>& to) const {
+            // every distinct vertex is searched once, repeated ones share its row or column;
+            // the stops without a vertex get no position
+            constexpr size_t NO_POSITION = std::numeric_limits<size_t>::max();
+            auto unique_vertices = [&](const std::vector<const Stop*>& stops, std::vector<size_t>& positions) {
+                std::unordered_map<graph::VertexId, size_t> indexes;
+                std::vector<graph::VertexId> result;
+                positions.reserve(stops.size());
+                for (const Stop* stop : stops) {
+                    const graph::VertexId vertex = GetStopVertex(stop);
+                    if (vertex == NO_VERTEX) {
+                        positions.push_back(NO_POSITION);
+                        continue;
+                    }
+                    auto [it, inserted] = indexes.emplace(vertex, result.size());
+                    if (inserted) {
+                        result.push_back(vertex);
+                    }
+                    positions.push_back(it->second);
+                }
+                return result;
+            };
+            std::vector<size_t> from_positions;
+            std::vector<size_t> to_positions;
+            const std::vector<graph::VertexId> sources = unique_vertices(from, from_positions);
+            const std::vector<graph::VertexId> targets = unique_vertices(to, to_positions);
+            graph::RouterInterface<double>::WeightsTable weights;
+            if (raptor_) {
+                weights.reserve(sources.size());
+                for (const graph::VertexId source : sources) {
+                    weights.push_back(raptor_->ComputeTimes(source, targets));
+                }
+            }
+            else {
+                weights = router_->BuildWeights(sources, targets);
+            }
+
+            std::vector<std::vector<std::optional<double>>> result(from.size(), std::vector<std::optional<double>>(to.size()));
+            for (size_t i = 0; i < from.size(); ++i) {
+                for (size_t j = 0; j < to.size(); ++j) {
+                    if (from_positions[i] != NO_POSITION && to_positions[j] != NO_POSITION) {
+                        result[i][j] = weights[from_positions[i]][to_positions[j]];
+                    }
+                    else if (from[i] == to[j]) {
+                        result[i][j] = 0.0;
+                    }
+                }
+            }
+            return result;
+        }
 
+        std::vector<std::pair<const Stop*, double>> TransportRouter::ComputeIsochrone(const Stop* from_stop,
+                                                                                      double max_time) const {
+            const graph::VertexId from = GetStopVertex(from_stop);
+            if (from == NO_VERTEX) {
+                return { { from_stop, 0 } };
+            }
+            // the stop vertices go before the ride vertices
+            graph::RouterInterface<double>::ReachedVertices reached;
+            if (raptor_) {
+                std::vector<graph::VertexId> targets(stop_vertex_count_);
+                std::iota(targets.begin(), targets.end(), 0);
+                const std::vector<std::optional<double>> times = raptor_->ComputeTimes(from, targets);
+                for (const graph::VertexId vertex : targets) {
+                    if (times[vertex] && !(max_time < *times[vertex])) {
+                        reached.push_back({ vertex, *times[vertex] });
+                    }
+                }
+            }
+            else {
+                reached = router_->BuildReachable(from, stop_vertex_count_, max_time);
             }
+            std::vector<std::pair<const Stop*, double>> result;
+            result.reserve(reached.size());
+            for (const auto& [vertex, time] : reached) {
+                result.push_back({ vertex_stops_[vertex], time });
+            }
+            std::sort(result.begin(), result.end(), [](const auto& lhs, const auto& rhs) {
+                return std::tie(lhs.second, lhs.first->name) < std::tie(rhs.second, rhs.first->name);
+            });
             return result;
         }
 
@@ -31,31 +268,547 @@ namespace tr_cat {
             if (graph_.GetVertexCount() > 0) {
                 throw std::logic_error("Recreate graph"s);
             }
-            graph_.SetVertexCount(catalog_.GetVertexCount());
-            const double kmh_to_mmin = 1000 * 1.0 / 60;
-            double bus_velocity = routing_settings_.bus_velocity * kmh_to_mmin;
+            if (stop_vertices_.empty()) {
+                NumberStops();
+            }
+            graph_.SetVertexCount(CountVertices());
+            if (routing_settings_.router_type == RouterType::RAPTOR) {
+                // the router works on the buses themselves, the graph keeps only the stops
+                graph_.Finalize();
+                if (create_router) {
+                    CreateRouter();
+                    CreateProfiles();
+                }
+                return;
+            }
 
+            std::vector<const Bus*> buses;
+            std::vector<graph::VertexId> first_ride_vertices;
+            graph::VertexId next_vertex = stop_vertex_count_;
             for (std::string_view bus_name : catalog_) {
                 const Bus* bus = *(catalog_.GetBusInfo(bus_name));
-                auto it = bus->stops.begin();
-                if (it == bus->stops.end() || it + 1 == bus->stops.end()) {
+                if (bus->stops.size() < 2) {
                     continue;
                 }
-                for (; it + 1 != bus->stops.end(); ++it) {
-                    double time = double(routing_settings_.bus_wait_time);
-                    for (auto next_vertex = it + 1; next_vertex != bus->stops.end(); ++next_vertex) {
-                        time += catalog_.GetDistance(*prev(next_vertex), *next_vertex) / bus_velocity;
-                        edges_[graph_.AddEdge({ (*it)->vertex_id,
-                                                (*next_vertex)->vertex_id,
-                                                time })] = { *it,
-                                                            bus,
-                                                            static_cast<uint32_t>(next_vertex - it) };
-                    }
+                buses.push_back(bus);
+                first_ride_vertices.push_back(next_vertex);
+                if (routing_settings_.graph_model == GraphModel::LINEAR) {
+                    next_vertex += bus->stops.size();
+                }
+            }
+
+            // the buses are independent: their edges are made concurrently and merged in the order
+            // of the buses, so the edge ids do not depend on the number of threads
+            std::vector<BusEdges> batches(buses.size());
+            {
+                concurrency::ThreadPool pool(routing_settings_.build_threads);
+                concurrency::ParallelFor(&pool, buses.size(), [&](size_t i) {
+                    batches[i] = routing_settings_.graph_model == GraphModel::LINEAR
+                        ? MakeLinearBusEdges(buses[i], first_ride_vertices[i])
+                        : MakeCompleteBusEdges(buses[i]);
+                });
+            }
+            if (routing_settings_.prune_parallel_edges) {
+                pruned_edge_count_ = PruneParallelEdges(batches);
+            }
+            size_t edge_count = 0;
+            for (const BusEdges& batch : batches) {
+                edge_count += batch.size();
+            }
+            graph_.ReserveEdges(edge_count);
+            edges_.reserve(edge_count);
+            for (BusEdges& batch : batches) {
+                for (const auto& [edge, info] : batch) {
+                    AddEdge(edge, info);
                 }
+                BusEdges().swap(batch);
             }
+            graph_.Finalize();
             if (create_router) {
-                router_ = std::make_unique<graph::Router<double>>(graph_);
+                routing_settings_.router_type = ResolveRouterType();
+                if (matrix_memory_budget_) {
+                    if (routing_settings_.router_type != RouterType::MATRIX || !routing_settings_.profiles.empty()) {
+                        throw std::logic_error("Only the routes matrix of a single profile can be computed in batches"s);
+                    }
+                    // the rows are computed while the base is written
+                    return;
+                }
+                CreateRouter();
+                CreateProfiles();
+            }
+        }
+
+        RoutesSection TransportRouter::GetStreamedMatrixLayout() const {
+            return { graph_.GetVertexCount(), row_range_ ? *row_range_ : graph::RowRange{ 0, graph_.GetVertexCount() },
+                     routing_settings_.weight_type == WeightType::TICKS ? sizeof(Ticks) : sizeof(double), {}, nullptr };
+        }
+
+        void TransportRouter::StreamRoutesMatrix(const std::function<void(const RoutesSection&)>& write_rows) {
+            const graph::RowRange rows = GetStreamedMatrixLayout().rows;
+            if (routing_settings_.weight_type == WeightType::TICKS) {
+                try {
+                    ticks_graph_ = graph::ScaleGraph<Ticks>(graph_, GetTicksPerMinute());
+                    StreamRows(ticks_graph_, rows, *matrix_memory_budget_, routing_settings_.build_threads, write_rows);
+                    return;
+                }
+                catch (const std::overflow_error&) {
+                    routing_settings_.weight_type = WeightType::DOUBLE;
+                    throw;
+                }
+            }
+            StreamRows(graph_, rows, *matrix_memory_budget_, routing_settings_.build_threads, write_rows);
+        }
+
+        void TransportRouter::AddBus(const Bus* bus) {
+            const bool new_stop_vertices = std::any_of(bus->stops.begin(), bus->stops.end(), [this](const Stop* stop) {
+                return GetStopVertex(stop) == NO_VERTEX;
+            });
+            if (routing_settings_.graph_model != GraphModel::COMPLETE || routing_settings_.router_type == RouterType::RAPTOR
+                || new_stop_vertices) {
+                // newly served stops or ride vertices change the vertex numbering, RAPTOR has nothing to build anyway
+                router_.reset();
+                raptor_.reset();
+                edges_.clear();
+                stop_vertices_.clear();
+                vertex_stops_.clear();
+                graph_ = graph::DirectedWeightedGraph<double>();
+                CreateGraph();
+                return;
+            }
+            if (bus->stops.size() < 2) {
+                return;
+            }
+            const graph::EdgeId first_new_edge = graph_.GetEdgeCount();
+            BusEdges bus_edges = MakeCompleteBusEdges(bus);
+            if (routing_settings_.prune_parallel_edges) {
+                std::vector<BusEdges> batches(1);
+                batches.front().swap(bus_edges);
+                pruned_edge_count_ += PruneParallelEdges(batches);
+                bus_edges.swap(batches.front());
+                pruned_edge_count_ += PruneDominatedEdges(bus_edges);
+            }
+            for (const auto& [edge, info] : bus_edges) {
+                AddEdge(edge, info);
+            }
+            graph_.Finalize();
+            UpdateRouter(first_new_edge);
+            for (const auto& profile : profiles_) {
+                profile->AddBaseEdges(first_new_edge);
+                profile->UpdateRouter(first_new_edge);
+            }
+            UnifyWeightTypes();
+        }
+
+        void TransportRouter::UpdateRouter(graph::EdgeId first_new_edge) {
+            routes_cache_->clear();
+            if (routing_settings_.router_type == RouterType::MATRIX) {
+                UpdateRoutesMatrix(first_new_edge);
+            }
+            else {
+                CreateRouter();
+            }
+        }
+
+        void TransportRouter::AddBaseEdges(graph::EdgeId first_edge) {
+            const std::vector<EdgeInfo>& edge_infos = GetEdgeInfos();
+            for (graph::EdgeId edge_id = first_edge; edge_id < base_->graph_.GetEdgeCount(); ++edge_id) {
+                const graph::Edge<double>& edge = base_->graph_.GetEdge(edge_id);
+                graph_.AddEdge({ edge.from, edge.to, GetEdgeWeight(edge_infos[edge_id]) });
+            }
+            graph_.Finalize();
+        }
+
+        void TransportRouter::UpdateRoutesMatrix(graph::EdgeId first_new_edge) {
+            std::vector<graph::EdgeId> new_edges(graph_.GetEdgeCount() - first_new_edge);
+            std::iota(new_edges.begin(), new_edges.end(), first_new_edge);
+            concurrency::ThreadPool pool(routing_settings_.build_threads);
+            // a bus joining two components changes the blocks of the matrix
+            if (routing_settings_.weight_type == WeightType::DOUBLE) {
+                if (!static_cast<graph::ComponentRouter<double>&>(*router_).AddEdges(new_edges, &pool)) {
+                    ++matrix_rebuild_count_;
+                    CreateRouter();
+                }
+                return;
+            }
+            try {
+                // the matrix keeps referring to ticks_graph_, which is refilled in place
+                ticks_graph_ = graph::ScaleGraph<Ticks>(graph_, GetTicksPerMinute());
+                auto& matrix = static_cast<graph::ScaledRouter<double, Ticks>&>(*router_).GetRouter();
+                if (!static_cast<graph::ComponentRouter<Ticks>&>(matrix).AddEdges(new_edges, &pool)) {
+                    ++matrix_rebuild_count_;
+                    CreateRouter();
+                }
+            }
+            catch (const std::overflow_error&) {
+                routing_settings_.weight_type = WeightType::DOUBLE;
+                CreateRouter();
+            }
+        }
+
+        double TransportRouter::GetBusVelocity() const {
+            const double kmh_to_mmin = 1000 * 1.0 / 60;
+            return routing_settings_.bus_velocity * kmh_to_mmin;
+        }
+
+        // a meter of a ride is 3 ticks and a minute of waiting is 50 * bus_velocity ticks
+        double TransportRouter::GetTicksPerMinute() const {
+            return 50.0 * routing_settings_.bus_velocity;
+        }
+
+        void TransportRouter::NumberStops() {
+            // the stops of the buses in the order of the catalogue
+            std::vector<const Stop*> served_stops(catalog_.GetVertexCount(), nullptr);
+            for (std::string_view bus_name : catalog_) {
+                for (const Stop* stop : (*catalog_.GetBusInfo(bus_name))->stops) {
+                    served_stops[stop->vertex_id] = stop;
+                }
+            }
+            std::vector<const Stop*> stops;
+            std::copy_if(served_stops.begin(), served_stops.end(), std::back_inserter(stops),
+                [](const Stop* stop) { return stop != nullptr; });
+            if (routing_settings_.vertex_order == VertexOrder::HILBERT && !stops.empty()) {
+                geo::Coordinates min = stops.front()->coordinates;
+                geo::Coordinates max = min;
+                for (const Stop* stop : stops) {
+                    min = { std::min(min.lat, stop->coordinates.lat), std::min(min.lng, stop->coordinates.lng) };
+                    max = { std::max(max.lat, stop->coordinates.lat), std::max(max.lng, stop->coordinates.lng) };
+                }
+                std::vector<std::pair<uint64_t, const Stop*>> keyed_stops;
+                keyed_stops.reserve(stops.size());
+                for (const Stop* stop : stops) {
+                    keyed_stops.push_back({ geo::ComputeHilbertIndex(stop->coordinates, min, max), stop });
+                }
+                std::stable_sort(keyed_stops.begin(), keyed_stops.end(), [](const auto& lhs, const auto& rhs) {
+                    return lhs.first < rhs.first;
+                });
+                for (size_t i = 0; i < stops.size(); ++i) {
+                    stops[i] = keyed_stops[i].second;
+                }
+            }
+            stop_vertices_.assign(catalog_.GetVertexCount(), NO_VERTEX);
+            stop_vertex_count_ = stops.size();
+            for (size_t i = 0; i < stops.size(); ++i) {
+                stop_vertices_[stops[i]->vertex_id] = i;
+            }
+            vertex_stops_ = std::move(stops);
+        }
+
+        // the inverse of stop_vertices_ for a numbering read from a base
+        void TransportRouter::IndexVertexStops() {
+            vertex_stops_.assign(stop_vertex_count_, nullptr);
+            for (std::string_view stop_name : catalog_.GetSortedStopsNames()) {
+                const Stop* stop = *catalog_.GetStopInfo(stop_name);
+                if (const graph::VertexId vertex = GetStopVertex(stop); vertex != NO_VERTEX) {
+                    vertex_stops_[vertex] = stop;
+                }
+            }
+        }
+
+        // the stops added after the graph was built are not served by its buses
+        graph::VertexId TransportRouter::GetStopVertex(const Stop* stop) const {
+            return stop->vertex_id < stop_vertices_.size() ? stop_vertices_[stop->vertex_id] : NO_VERTEX;
+        }
+
+        size_t TransportRouter::CountVertices() const {
+            size_t vertex_count = stop_vertex_count_;
+            if (routing_settings_.graph_model == GraphModel::LINEAR && routing_settings_.router_type != RouterType::RAPTOR) {
+                for (std::string_view bus_name : catalog_) {
+                    const Bus* bus = *(catalog_.GetBusInfo(bus_name));
+                    if (bus->stops.size() >= 2) {
+                        vertex_count += bus->stops.size();
+                    }
+                }
+            }
+            return vertex_count;
+        }
+
+        void TransportRouter::AddEdge(const graph::Edge<double>& edge, EdgeInfo info) {
+            graph_.AddEdge(edge);
+            edges_.push_back(info);
+        }
+
+        double TransportRouter::GetEdgeWeight(const EdgeInfo& info) const {
+            return (info.stop ? double(routing_settings_.bus_wait_time) : 0.0) + info.distance / GetBusVelocity();
+        }
+
+        std::vector<double> TransportRouter::GetRideDistances(const Bus* bus) const {
+            std::vector<double> ride_distances(bus->stops.size() - 1);
+            for (size_t i = 0; i + 1 < bus->stops.size(); ++i) {
+                ride_distances[i] = catalog_.GetDistance(bus->stops[i], bus->stops[i + 1]);
+            }
+            return ride_distances;
+        }
+
+        TransportRouter::BusEdges TransportRouter::MakeCompleteBusEdges(const Bus* bus) const {
+            const std::vector<double> ride_distances = GetRideDistances(bus);
+            const size_t stop_count = bus->stops.size();
+            BusEdges result;
+            result.reserve(stop_count * (stop_count - 1) / 2);
+            for (size_t from = 0; from + 1 < stop_count; ++from) {
+                EdgeInfo info{ bus->stops[from], bus, 0, 0.0 };
+                for (size_t to = from + 1; to < stop_count; ++to) {
+                    ++info.count;
+                    info.distance += ride_distances[to - 1];
+                    result.push_back({ { GetStopVertex(bus->stops[from]), GetStopVertex(bus->stops[to]), GetEdgeWeight(info) },
+                                       info });
+                }
+            }
+            return result;
+        }
+
+        TransportRouter::BusEdges TransportRouter::MakeLinearBusEdges(const Bus* bus, graph::VertexId first_ride_vertex) const {
+            const std::vector<double> ride_distances = GetRideDistances(bus);
+            BusEdges result;
+            result.reserve(3 * ride_distances.size());
+            for (size_t i = 0; i + 1 < bus->stops.size(); ++i) {
+                const Stop* stop = bus->stops[i];
+                const graph::VertexId ride_vertex = first_ride_vertex + i;
+                const EdgeInfo board{ stop, bus, 0, 0.0 };
+                const EdgeInfo ride{ nullptr, bus, 1, ride_distances[i] };
+                result.push_back({ { GetStopVertex(stop), ride_vertex, GetEdgeWeight(board) }, board });
+                result.push_back({ { ride_vertex, ride_vertex + 1, GetEdgeWeight(ride) }, ride });
+                result.push_back({ { ride_vertex + 1, GetStopVertex(bus->stops[i + 1]), 0 },
+                                   { nullptr, nullptr, 0, 0.0 } });
+            }
+            return result;
+        }
+
+        // keeps the preferred edge of every vertex pair in the place of the first one, returns the number removed
+        size_t TransportRouter::PruneParallelEdges(std::vector<BusEdges>& batches) const {
+            std::unordered_map<VertexPair, std::pair<size_t, size_t>, VertexPairHasher> kept;  // batch, index in it
+            std::vector<std::vector<bool>> removed(batches.size());
+            size_t removed_count = 0;
+            for (size_t b = 0; b < batches.size(); ++b) {
+                removed[b].assign(batches[b].size(), false);
+                for (size_t i = 0; i < batches[b].size(); ++i) {
+                    const graph::Edge<double>& edge = batches[b][i].first;
+                    const auto [it, inserted] = kept.emplace(VertexPair{ edge.from, edge.to }, std::make_pair(b, i));
+                    if (inserted) {
+                        continue;
+                    }
+                    auto& kept_edge = batches[it->second.first][it->second.second];
+                    if (IsPreferredEdge(edge, batches[b][i].second, kept_edge.first, kept_edge.second)) {
+                        kept_edge = batches[b][i];
+                    }
+                    removed[b][i] = true;
+                    ++removed_count;
+                }
+            }
+            for (size_t b = 0; b < batches.size(); ++b) {
+                size_t next = 0;
+                for (size_t i = 0; i < batches[b].size(); ++i) {
+                    if (!removed[b][i]) {
+                        batches[b][next++] = batches[b][i];
+                    }
+                }
+                batches[b].resize(next);
+            }
+            return removed_count;
+        }
+
+        // removes the edges of a bus added to the built graph that are not faster than an edge already there,
+        // an edge of the same weight is given over to the bus if it is preferred; the slower edges
+        // the bus replaces stay in the graph until it is built again
+        size_t TransportRouter::PruneDominatedEdges(BusEdges& bus_edges) {
+            std::vector<graph::VertexId> sources;
+            for (const auto& [edge, info] : bus_edges) {
+                sources.push_back(edge.from);
+            }
+            std::sort(sources.begin(), sources.end());
+            sources.erase(std::unique(sources.begin(), sources.end()), sources.end());
+            std::unordered_map<VertexPair, graph::EdgeId, VertexPairHasher> existing;
+            for (const graph::VertexId source : sources) {
+                for (const graph::IncidentEdge<double>& other : graph_.GetIncidentEdges(source)) {
+                    auto [it, inserted] = existing.emplace(VertexPair{ source, other.to }, other.id);
+                    if (!inserted && IsPreferredEdge(graph_.GetEdge(other.id), edges_[other.id],
+                                                     graph_.GetEdge(it->second), edges_[it->second])) {
+                        it->second = other.id;
+                    }
+                }
+            }
+            const size_t size_before = bus_edges.size();
+            bus_edges.erase(std::remove_if(bus_edges.begin(), bus_edges.end(), [&](const auto& bus_edge) {
+                const auto it = existing.find({ bus_edge.first.from, bus_edge.first.to });
+                if (it == existing.end() || bus_edge.first.weight < graph_.GetEdge(it->second).weight) {
+                    return false;
+                }
+                if (IsPreferredEdge(bus_edge.first, bus_edge.second, graph_.GetEdge(it->second), edges_[it->second])) {
+                    edges_[it->second] = bus_edge.second;
+                }
+                return true;
+            }), bus_edges.end());
+            return size_before - bus_edges.size();
+        }
+
+        RouterType TransportRouter::ResolveRouterType() const {
+            if (routing_settings_.router_type != RouterType::AUTO) {
+                return routing_settings_.router_type;
+            }
+            if (matrix_memory_budget_) {
+                // the matrix is only paged in by the queries
+                return RouterType::MATRIX;
+            }
+            const size_t matrix_memory = (routing_settings_.weight_type == WeightType::TICKS
+                ? graph::ComponentRouter<Ticks>::EstimateMemory(graph_)
+                : graph::ComponentRouter<double>::EstimateMemory(graph_)) * (1 + routing_settings_.profiles.size());
+            if (matrix_memory > routing_settings_.router_memory_limit) {
+                return RouterType::DIJKSTRA;
+            }
+            return RouterType::MATRIX;
+        }
+
+        void TransportRouter::CreateRouter(const transport_catalog_serialize::Router* router_data,
+                                           std::optional<RoutesSection> routes_section) {
+            if (row_range_ && (routing_settings_.router_type != RouterType::MATRIX || !routing_settings_.profiles.empty())) {
+                throw std::logic_error("Only the routes matrix of a single profile can be computed in parts"s);
+            }
+            switch (routing_settings_.router_type) {
+            case RouterType::MATRIX:
+                if (routing_settings_.weight_type == WeightType::TICKS) {
+                    try {
+                        CreateTicksMatrix(std::move(routes_section));
+                        break;
+                    }
+                    catch (const std::overflow_error&) {
+                        // some route is longer than 2^32 ticks
+                        routing_settings_.weight_type = WeightType::DOUBLE;
+                    }
+                }
+                // the parts of a sharded build hold rows of the whole graph, all the others the blocks of its components
+                if (routes_section) {
+                    router_ = std::make_unique<graph::ComponentRouter<double>>(graph_,
+                        MakeBlocksView<double>(std::move(*routes_section)));
+                }
+                else if (row_range_) {
+                    concurrency::ThreadPool pool(routing_settings_.build_threads);
+                    router_ = std::make_unique<graph::Router<double>>(graph_, *row_range_, &pool);
+                }
+                else {
+                    concurrency::ThreadPool pool(routing_settings_.build_threads);
+                    router_ = std::make_unique<graph::ComponentRouter<double>>(graph_, &pool);
+                }
+                break;
+            case RouterType::DIJKSTRA:
+                if (routing_settings_.goal_direction == GoalDirection::NONE) {
+                    router_ = std::make_unique<graph::DijkstraRouter<double>>(graph_,
+                        routing_settings_.router_memory_limit / graph::DijkstraRouter<double>::EstimateRowMemory(graph_.GetVertexCount()));
+                }
+                else {
+                    router_ = std::make_unique<graph::AStarRouter<double>>(graph_, CreateLowerBound(router_data));
+                }
+                break;
+            case RouterType::RAPTOR:
+                raptor_ = std::make_unique<RaptorRouter>(catalog_, stop_vertices_, stop_vertex_count_,
+                    double(routing_settings_.bus_wait_time), GetBusVelocity());
+                break;
+            case RouterType::CONTRACTION_HIERARCHY:
+                if (router_data) {
+                    router_ = std::make_unique<graph::ContractionHierarchy<double>>(graph_, router_data->contraction_hierarchy());
+                }
+                else {
+                    router_ = std::make_unique<graph::ContractionHierarchy<double>>(graph_);
+                }
+                break;
+            case RouterType::HUB_LABELS:
+                if (router_data) {
+                    router_ = std::make_unique<graph::HubLabels<double>>(graph_, router_data->hub_labels());
+                }
+                else {
+                    router_ = std::make_unique<graph::HubLabels<double>>(graph_);
+                }
+                break;
+            default:
+                throw std::logic_error("Unresolved router type"s);
+            }
+            routes_cache_ = std::make_unique<RoutesCache>(routing_settings_.route_cache_size, true);
+        }
+
+        void TransportRouter::CreateProfiles(const transport_catalog_serialize::Router* router_data,
+                                             std::optional<RoutesSection> routes_section) {
+            profiles_.clear();
+            const size_t matrix_count = 1 + routing_settings_.profiles.size();
+            for (size_t i = 0; i < routing_settings_.profiles.size(); ++i) {
+                profiles_.push_back(std::unique_ptr<TransportRouter>(new TransportRouter(*this, routing_settings_.profiles[i])));
+                std::optional<RoutesSection> profile_section;
+                if (routes_section) {
+                    profile_section = SliceRoutesSection(*routes_section, i + 1, matrix_count);
+                }
+                profiles_.back()->CreateRouter(router_data ? &router_data->profiles(static_cast<int>(i)) : nullptr,
+                                               std::move(profile_section));
+            }
+            UnifyWeightTypes();
+        }
+
+        void TransportRouter::UnifyWeightTypes() {
+            std::vector<TransportRouter*> routers{ this };
+            for (const auto& profile : profiles_) {
+                routers.push_back(profile.get());
+            }
+            const bool double_weights = std::any_of(routers.begin(), routers.end(), [](const TransportRouter* router) {
+                return router->routing_settings_.weight_type == WeightType::DOUBLE;
+            });
+            if (routing_settings_.router_type != RouterType::MATRIX || !double_weights) {
+                return;
+            }
+            for (TransportRouter* router : routers) {
+                if (router->routing_settings_.weight_type == WeightType::TICKS) {
+                    router->routing_settings_.weight_type = WeightType::DOUBLE;
+                    router->CreateRouter();
+                }
+            }
+        }
+
+        void TransportRouter::CreateTicksMatrix(std::optional<RoutesSection> routes_section) {
+            ticks_graph_ = graph::ScaleGraph<Ticks>(graph_, GetTicksPerMinute());
+            std::unique_ptr<graph::RouterInterface<Ticks>> matrix;
+            if (routes_section) {
+                matrix = std::make_unique<graph::ComponentRouter<Ticks>>(ticks_graph_,
+                    MakeBlocksView<Ticks>(std::move(*routes_section)));
+            }
+            else if (row_range_) {
+                concurrency::ThreadPool pool(routing_settings_.build_threads);
+                matrix = std::make_unique<graph::Router<Ticks>>(ticks_graph_, *row_range_, &pool);
+            }
+            else {
+                concurrency::ThreadPool pool(routing_settings_.build_threads);
+                matrix = std::make_unique<graph::ComponentRouter<Ticks>>(ticks_graph_, &pool);
+            }
+            router_ = std::make_unique<graph::ScaledRouter<double, Ticks>>(std::move(matrix), GetTicksPerMinute());
+        }
+
+        std::unique_ptr<const graph::LowerBound<double>> TransportRouter::CreateLowerBound(
+            const transport_catalog_serialize::Router* router_data) const {
+            if (routing_settings_.goal_direction == GoalDirection::GEO) {
+                return std::make_unique<graph::GeoLowerBound<double>>(graph_, GetVertexCoordinates());
             }
+            if (router_data) {
+                return std::make_unique<graph::Landmarks<double>>(graph_, router_data->landmarks());
+            }
+            return std::make_unique<graph::Landmarks<double>>(graph_, routing_settings_.landmark_count);
+        }
+
+        std::vector<geo::Coordinates> TransportRouter::GetVertexCoordinates() const {
+            // ride vertices are placed at their stops, in the order CreateGraph numbers them
+            std::vector<geo::Coordinates> coordinates(graph_.GetVertexCount());
+            for (std::string_view stop_name : catalog_.GetSortedStopsNames()) {
+                const Stop* stop = *catalog_.GetStopInfo(stop_name);
+                if (const graph::VertexId vertex = GetStopVertex(stop); vertex != NO_VERTEX) {
+                    coordinates.at(vertex) = stop->coordinates;
+                }
+            }
+            if (routing_settings_.graph_model == GraphModel::LINEAR) {
+                graph::VertexId next_vertex = stop_vertex_count_;
+                for (std::string_view bus_name : catalog_) {
+                    const Bus* bus = *(catalog_.GetBusInfo(bus_name));
+                    if (bus->stops.size() < 2) {
+                        continue;
+                    }
+                    for (const Stop* stop : bus->stops) {
+                        coordinates.at(next_vertex++) = stop->coordinates;
+                    }
+                }
+            }
+            return coordinates;
         }
 
         transport_catalog_serialize::Router TransportRouter::Serialize(bool with_graph) const {
@@ -63,49 +816,173 @@ namespace tr_cat {
             transport_catalog_serialize::RoutingSettings settings;
             settings.set_bus_wait_time(routing_settings_.bus_wait_time);
             settings.set_bus_velocity(routing_settings_.bus_velocity);
+            settings.set_router_type(static_cast<uint32_t>(routing_settings_.router_type));
+            settings.set_router_memory_limit(routing_settings_.router_memory_limit);
+            settings.set_graph_model(static_cast<uint32_t>(routing_settings_.graph_model));
+            settings.set_route_cache_size(static_cast<uint32_t>(routing_settings_.route_cache_size));
+            settings.set_goal_direction(static_cast<uint32_t>(routing_settings_.goal_direction));
+            settings.set_landmark_count(static_cast<uint32_t>(routing_settings_.landmark_count));
+            settings.set_weight_type(static_cast<uint32_t>(routing_settings_.weight_type));
+            settings.set_vertex_order(static_cast<uint32_t>(routing_settings_.vertex_order));
+            settings.set_prune_parallel_edges(routing_settings_.prune_parallel_edges);
+            for (const RoutingProfile& profile : routing_settings_.profiles) {
+                transport_catalog_serialize::RoutingProfile& profile_out = *settings.add_profiles();
+                profile_out.set_name(profile.name);
+                profile_out.set_bus_wait_time(profile.bus_wait_time);
+                profile_out.set_bus_velocity(profile.bus_velocity);
+            }
             *data_out.mutable_settings() = settings;
-            *data_out.mutable_data() = router_->GetSerializeData();
+            if (!base_) {
+                data_out.mutable_stop_vertices()->Add(stop_vertices_.begin(), stop_vertices_.end());
+            }
+            for (const auto& profile : profiles_) {
+                *data_out.add_profiles() = profile->Serialize();
+            }
+            // the routes matrix is written by the serializator as a raw section
+            if (routing_settings_.router_type == RouterType::CONTRACTION_HIERARCHY) {
+                *data_out.mutable_contraction_hierarchy() =
+                    static_cast<const graph::ContractionHierarchy<double>&>(*router_).GetSerializeData();
+            }
+            else if (routing_settings_.router_type == RouterType::HUB_LABELS) {
+                *data_out.mutable_hub_labels() = static_cast<const graph::HubLabels<double>&>(*router_).GetSerializeData();
+            }
+            else if (routing_settings_.router_type == RouterType::DIJKSTRA
+                && routing_settings_.goal_direction == GoalDirection::LANDMARKS) {
+                const graph::LowerBound<double>& landmarks = static_cast<const graph::AStarRouter<double>&>(*router_).GetLowerBound();
+                *data_out.mutable_landmarks() = static_cast<const graph::Landmarks<double>&>(landmarks).GetSerializeData();
+            }
             if (with_graph) {
                 *data_out.mutable_graph() = graph_.GetSerializeData();
-                std::vector<std::string_view> buses(catalog_.begin(), catalog_.end());
-                std::vector<std::string_view> stops = catalog_.GetSortedStopsNames();
-                for (const auto& [edge_id, edge_info] : edges_) {
-                    transport_catalog_serialize::EdgeInfo info_to_out;
-                    auto it_stop = std::lower_bound(stops.begin(), stops.end(),
-                        edge_info.stop->name, std::less<>{});
-                    info_to_out.set_stop(static_cast<uint32_t>(it_stop - stops.begin()));
-                    auto it_bus = std::lower_bound(buses.begin(), buses.end(),
-                        edge_info.bus->name, std::less<>{});
-                    info_to_out.set_bus(static_cast<uint32_t>(it_bus - buses.begin()));
-                    info_to_out.set_count(edge_info.count);
-                    (*data_out.mutable_graph()->mutable_info())[edge_id] = info_to_out;
+                // a missing stop or bus is written as the index past the end
+                std::unordered_map<const Stop*, uint32_t> stop_indexes;
+                std::unordered_map<const Bus*, uint32_t> bus_indexes;
+                for (std::string_view stop_name : catalog_.GetSortedStopsNames()) {
+                    stop_indexes.emplace(*catalog_.GetStopInfo(stop_name), static_cast<uint32_t>(stop_indexes.size()));
+                }
+                for (std::string_view bus_name : catalog_) {
+                    bus_indexes.emplace(*catalog_.GetBusInfo(bus_name), static_cast<uint32_t>(bus_indexes.size()));
+                }
+                transport_catalog_serialize::Graph& graph = *data_out.mutable_graph();
+                graph.mutable_edge_stop()->Reserve(static_cast<int>(edges_.size()));
+                graph.mutable_edge_bus()->Reserve(static_cast<int>(edges_.size()));
+                graph.mutable_edge_count()->Reserve(static_cast<int>(edges_.size()));
+                graph.mutable_edge_distance()->Reserve(static_cast<int>(edges_.size()));
+                for (const EdgeInfo& edge_info : edges_) {
+                    graph.add_edge_stop(edge_info.stop ? stop_indexes.at(edge_info.stop) : static_cast<uint32_t>(stop_indexes.size()));
+                    graph.add_edge_bus(edge_info.bus ? bus_indexes.at(edge_info.bus) : static_cast<uint32_t>(bus_indexes.size()));
+                    graph.add_edge_count(static_cast<uint32_t>(edge_info.count));
+                    graph.add_edge_distance(edge_info.distance);
                 }
             }
             return data_out;
         }
 
-        bool TransportRouter::Deserialize(transport_catalog_serialize::Router& router_data, bool with_graph) {
-            routing_settings_ = { router_data.settings().bus_wait_time(),
-                                 router_data.settings().bus_velocity() };
+        std::optional<RoutesSection> TransportRouter::GetRoutesMatrix() const {
+            if (routing_settings_.router_type != RouterType::MATRIX) {
+                return std::nullopt;
+            }
+            RoutesSection section;
+            if (routing_settings_.weight_type == WeightType::TICKS) {
+                const auto& matrix = static_cast<const graph::ScaledRouter<double, Ticks>&>(*router_).GetRouter();
+                section = row_range_
+                    ? MakeRoutesSection(static_cast<const graph::Router<Ticks>&>(matrix))
+                    : MakeRoutesSection(static_cast<const graph::ComponentRouter<Ticks>&>(matrix), graph_.GetVertexCount());
+            }
+            else {
+                section = row_range_
+                    ? MakeRoutesSection(static_cast<const graph::Router<double>&>(*router_))
+                    : MakeRoutesSection(static_cast<const graph::ComponentRouter<double>&>(*router_), graph_.GetVertexCount());
+            }
+            for (const auto& profile : profiles_) {
+                const std::vector<RoutesSection::Cells> cells = profile->GetRoutesMatrix()->cells;
+                section.cells.insert(section.cells.end(), cells.begin(), cells.end());
+            }
+            return section;
+        }
+
+        bool TransportRouter::Deserialize(transport_catalog_serialize::Router& router_data, bool with_graph,
+                                          std::optional<RoutesSection> routes_section) {
+            routing_settings_ = { static_cast<int>(router_data.settings().bus_wait_time()),
+                                 static_cast<int>(router_data.settings().bus_velocity()),
+                                 static_cast<RouterType>(router_data.settings().router_type()),
+                                 static_cast<size_t>(router_data.settings().router_memory_limit()),
+                                 0,
+                                 static_cast<GraphModel>(router_data.settings().graph_model()),
+                                 static_cast<size_t>(router_data.settings().route_cache_size()),
+                                 static_cast<GoalDirection>(router_data.settings().goal_direction()),
+                                 static_cast<size_t>(router_data.settings().landmark_count()),
+                                 static_cast<WeightType>(router_data.settings().weight_type()),
+                                 static_cast<VertexOrder>(router_data.settings().vertex_order()),
+                                 router_data.settings().prune_parallel_edges(),
+                                 {} };
+            for (const transport_catalog_serialize::RoutingProfile& profile : router_data.settings().profiles()) {
+                routing_settings_.profiles.push_back({ profile.name(), static_cast<int>(profile.bus_wait_time()),
+                                                       static_cast<int>(profile.bus_velocity()) });
+            }
+            if (router_data.profiles_size() != static_cast<int>(routing_settings_.profiles.size())) {
+                throw std::invalid_argument("Base holds no routing data of some profiles"s);
+            }
+            if (routing_settings_.router_type == RouterType::AUTO) {
+                // bases written before the router type was stored always hold the matrix
+                routing_settings_.router_type = RouterType::MATRIX;
+            }
+            if (routing_settings_.router_memory_limit == 0) {
+                routing_settings_.router_memory_limit = DEFAULT_ROUTER_MEMORY_LIMIT;
+            }
+            if (routing_settings_.route_cache_size == 0) {
+                routing_settings_.route_cache_size = DEFAULT_ROUTE_CACHE_SIZE;
+            }
+            stop_vertices_.clear();
+            stop_vertex_count_ = 0;
+            for (const uint32_t vertex : router_data.stop_vertices()) {
+                if (vertex == std::numeric_limits<uint32_t>::max()) {
+                    stop_vertices_.push_back(NO_VERTEX);
+                    continue;
+                }
+                stop_vertices_.push_back(vertex);
+                stop_vertex_count_ = std::max(stop_vertex_count_, static_cast<size_t>(vertex) + 1);
+            }
+            IndexVertexStops();
             const transport_catalog_serialize::Graph& graph = router_data.graph();
             if (with_graph) {
-                std::vector<std::string_view> buses(catalog_.begin(), catalog_.end());
-                std::vector<std::string_view> stops = catalog_.GetSortedStopsNames();
-                graph_.SetVertexCount(stops.size());
-                for (int i = 0; i < graph.edges_size(); ++i) {
-                    uint32_t edge_id = graph_.AddEdge({ graph.edges(i).from(),
-                                                         graph.edges(i).to(),
-                                                         graph.edges(i).weight() });
-                    const transport_catalog_serialize::EdgeInfo& edge_info = (graph.info().at(edge_id));
-                    edges_[edge_id] = EdgeInfo{ *catalog_.GetStopInfo(stops[edge_info.stop()]),
-                                               *catalog_.GetBusInfo(buses[edge_info.bus()]),
-                                               edge_info.count() };
+                std::vector<const Stop*> stops;
+                std::vector<const Bus*> buses;
+                for (std::string_view stop_name : catalog_.GetSortedStopsNames()) {
+                    stops.push_back(*catalog_.GetStopInfo(stop_name));
+                }
+                for (std::string_view bus_name : catalog_) {
+                    buses.push_back(*catalog_.GetBusInfo(bus_name));
+                }
+                auto get_info = [&](uint32_t stop, uint32_t bus, uint32_t count, double distance) {
+                    return EdgeInfo{ stop < stops.size() ? stops[stop] : nullptr,
+                                     bus < buses.size() ? buses[bus] : nullptr,
+                                     static_cast<int>(count), distance };
+                };
+                graph_.SetVertexCount(graph.vertex_count() > 0 ? graph.vertex_count() : stops.size());
+                const int edge_count = graph.edge_from_size();
+                if (graph.edge_to_size() != edge_count || graph.edge_weight_size() != edge_count
+                    || graph.edge_stop_size() != edge_count || graph.edge_bus_size() != edge_count
+                    || graph.edge_count_size() != edge_count || graph.edge_distance_size() != edge_count) {
+                    throw std::invalid_argument("Graph edge columns differ in size"s);
+                }
+                edges_.reserve(edge_count);
+                for (int i = 0; i < edge_count; ++i) {
+                    AddEdge({ graph.edge_from(i), graph.edge_to(i), graph.edge_weight(i) },
+                            get_info(graph.edge_stop(i), graph.edge_bus(i), graph.edge_count(i), graph.edge_distance(i)));
                 }
+                graph_.Finalize();
             }
             else {
                 CreateGraph(false);
             }
-            router_ = std::make_unique<graph::Router<double>>(graph_, router_data.data());
+            if (routes_section && !routing_settings_.profiles.empty()) {
+                const size_t matrix_count = 1 + routing_settings_.profiles.size();
+                CreateRouter(&router_data, SliceRoutesSection(*routes_section, 0, matrix_count));
+            }
+            else {
+                CreateRouter(&router_data, routes_section);
+            }
+            CreateProfiles(&router_data, std::move(routes_section));
             return true;
         }
     }       // namespace router
@@ -2,24 +2,111 @@
 
 #include <memory>
 #include <set>
+#include <string>
+#include <string_view>
 #include <exception>
+#include <functional>
+#include <limits>
 #include <unordered_map>
+#include <utility>
 
 #include "transport_catalogue.h"
 #include "router.h"
+#include "component_router.h"
+#include "scaled_router.h"
+#include "dijkstra_router.h"
+#include "astar_router.h"
+#include "contraction_hierarchy.h"
+#include "hub_labels.h"
+#include "raptor_router.h"
+#include "lru_cache.h"
 #include "request_handler.h"
 
 namespace tr_cat {
     namespace router {
+        enum class RouterType {
+            AUTO,
+            MATRIX,
+            DIJKSTRA,
+            CONTRACTION_HIERARCHY,
+            RAPTOR,             // searches the stop sequences of the buses, builds no graph
+            HUB_LABELS,
+        };
+
+        // COMPLETE: an edge from every stop of a bus to every later one
+        // LINEAR: a wait vertex per stop and a ride vertex per bus stop position,
+        //         connected by boarding, riding to the next position and leaving edges
+        enum class GraphModel {
+            COMPLETE,
+            LINEAR,
+        };
+
+        // how the dijkstra router heads for the target of a route
+        // NONE: searches all around the source, keeping whole rows of routes
+        // GEO: A* with the straight line distance to the target as a bound
+        // LANDMARKS: A* with the bounds from the routes to and from landmark vertices, computed by make_base
+        enum class GoalDirection {
+            NONE,
+            GEO,
+            LANDMARKS,
+        };
+
+        // the weights the routes matrix is computed and stored in
+        // DOUBLE: minutes
+        // TICKS: 32-bit ticks of 1 / (50 * bus_velocity) minute, whole numbers for every ride and wait,
+        //        8 bytes a matrix cell instead of 12; falls back to DOUBLE if a route does not fit
+        enum class WeightType {
+            DOUBLE,
+            TICKS,
+        };
+
+        // how the stops are numbered in the routing graph
+        // CATALOGUE: in the order they were added to the catalogue
+        // HILBERT: along a Hilbert curve over their coordinates, so that the stops near each other
+        //          get near rows of the routes matrix and near edges of the graph
+        enum class VertexOrder {
+            CATALOGUE,
+            HILBERT,
+        };
+
+        using Ticks = uint32_t;
+
+        const size_t DEFAULT_ROUTER_MEMORY_LIMIT = size_t(1) << 30;
+        const size_t DEFAULT_ROUTE_CACHE_SIZE = 4096;
+        const size_t DEFAULT_LANDMARK_COUNT = 16;
+        // the vertex of a stop no bus serves
+        const graph::VertexId NO_VERTEX = std::numeric_limits<graph::VertexId>::max();
+
+        // other waits and speeds routed over the same graph, picked by name in the route requests
+        struct RoutingProfile {
+            std::string name;
+            int bus_wait_time = 0;
+            int bus_velocity = 0;
+        };
+
         struct RoutingSettings {
             int bus_wait_time = 0;
             int bus_velocity = 0;
+            RouterType router_type = RouterType::AUTO;
+            size_t router_memory_limit = DEFAULT_ROUTER_MEMORY_LIMIT;       // bytes
+            size_t build_threads = 0;                                       // 0 - one per hardware core
+            GraphModel graph_model = GraphModel::COMPLETE;
+            size_t route_cache_size = DEFAULT_ROUTE_CACHE_SIZE;            // completed routes kept
+            GoalDirection goal_direction = GoalDirection::NONE;
+            size_t landmark_count = DEFAULT_LANDMARK_COUNT;
+            WeightType weight_type = WeightType::DOUBLE;
+            VertexOrder vertex_order = VertexOrder::CATALOGUE;
+            bool prune_parallel_edges = false;                              // keep one edge per vertex pair
+            std::vector<RoutingProfile> profiles;                           // sorted by name
         };
 
+        // stop is set on edges that board a bus, bus is not set on edges that leave it,
+        // count is the number of stops ridden and distance the meters of the ride
         struct EdgeInfo {
             const Stop* stop;
             const Bus* bus;
             int count;
+            double distance;
         };
 
         struct CompletedRoute {
@@ -34,23 +121,150 @@ namespace tr_cat {
             std::vector<Line> route;
         };
 
+        // the routes matrix as raw memory, weight_size bytes a weight: the rows of the whole graph
+        // or the blocks of its components one after another
+        struct RoutesSection {
+            using PrevEdge = graph::Router<double>::PrevEdge;
+
+            // cells of the matrix lying together in memory
+            struct Cells {
+                const void* weights;
+                const PrevEdge* prev_edges;
+                size_t count;
+            };
+
+            size_t vertex_count;
+            graph::RowRange rows;                                           // all of them but in the parts of a sharded build
+            size_t weight_size;
+            std::vector<Cells> cells;                                       // one run when read from a base
+            std::shared_ptr<const void> storage;                            // keeps mapped memory alive
+        };
+
+        struct CacheStats {
+            size_t hits;
+            size_t misses;
+        };
+
         class TransportRouter {
+        private:        // names
+            using VertexPair = std::pair<graph::VertexId, graph::VertexId>;
+            using BusEdges = std::vector<std::pair<graph::Edge<double>, EdgeInfo>>;
+
+            struct VertexPairHasher {
+                size_t operator()(const VertexPair& vertices) const {
+                    return std::hash<graph::VertexId>{}(vertices.first * 0x9E3779B97F4A7C15ull ^ vertices.second);
+                }
+            };
+
+            // not found routes are cached too
+            using RoutesCache = cache::LruCache<VertexPair, std::optional<CompletedRoute>, VertexPairHasher>;
+
         private:        // fields
             RoutingSettings routing_settings_;
             graph::DirectedWeightedGraph<double> graph_;
+            graph::DirectedWeightedGraph<Ticks> ticks_graph_;               // graph_ in ticks for WeightType::TICKS
             const aggregations::TransportCatalogue& catalog_;
-            std::unordered_map<graph::EdgeId, EdgeInfo> edges_;
-            std::unique_ptr<graph::Router<double>> router_;
+            std::vector<EdgeInfo> edges_;                                   // indexed by edge id
+            // graph vertices by Stop::vertex_id, the stops no bus serves get none; the stops of the buses
+            // are numbered in the vertex order of the settings, ride vertices go after them
+            std::vector<graph::VertexId> stop_vertices_;
+            std::vector<const Stop*> vertex_stops_;                         // the stop of every stop vertex
+            size_t stop_vertex_count_ = 0;
+            size_t pruned_edge_count_ = 0;                                  // parallel edges left out of graph_
+            size_t matrix_rebuild_count_ = 0;                               // added buses that joined components
+            std::unique_ptr<graph::RouterInterface<double>> router_;
+            std::unique_ptr<RaptorRouter> raptor_;                          // set instead of router_ for RAPTOR
+            std::unique_ptr<RoutesCache> routes_cache_;
+            std::optional<graph::RowRange> row_range_;                      // the part of the routes matrix to compute
+            std::optional<size_t> matrix_memory_budget_;                    // bytes of matrix rows computed at a time
+            // a router of a profile shares the edges, the stops and the settings of its base
+            // and gets a graph with its own weights and its own routing data
+            const TransportRouter* base_ = nullptr;
+            std::vector<std::unique_ptr<TransportRouter>> profiles_;       // in the order of the settings
 
         public:         // constructors
             explicit TransportRouter(const aggregations::TransportCatalogue& catalog) :catalog_(catalog) { }
 
+        private:        // constructors
+            TransportRouter(const TransportRouter& base, const RoutingProfile& profile);
+
         public:         // methods
-            std::optional<CompletedRoute> ComputeRoute(graph::VertexId from, graph::VertexId to);
+            // this router for an empty name
+            TransportRouter& GetProfile(std::string_view name);
+            bool HasProfile(std::string_view name) const;
+            // a stop no bus serves is only reachable from itself, by an empty route
+            std::optional<CompletedRoute> ComputeRoute(const Stop* from, const Stop* to);
+            // travel times between all the pairs, table[from][to] is empty if there is no route
+            std::vector<std::vector<std::optional<double>>> ComputeTimes(const std::vector<const Stop*>& from,
+                                                                          const std::vector<const Stop*>& to) const;
+            // the stops reachable from the stop within max_time with the times to them, the nearest first
+            std::vector<std::pair<const Stop*, double>> ComputeIsochrone(const Stop* from, double max_time) const;
             void CreateGraph(bool create_router = true);
+            // adds the edges of a bus just added to the catalog, updating the routes matrix in place
+            // when the vertices stay the same and rebuilding the graph and the router otherwise
+            void AddBus(const Bus* bus);
             void SetSettings(RoutingSettings&& settings) { routing_settings_ = settings; }
+            void SetBuildThreads(size_t thread_count) { routing_settings_.build_threads = thread_count; }
+            // the routes matrix is only computed for these sources, the parts are put together by merge_base
+            void SetRowRange(graph::RowRange rows) { row_range_ = rows; }
+            // the routes matrix is not kept in memory but computed by batches of rows taking up to this many bytes,
+            // which the serializator writes out one after another
+            void SetMatrixMemoryBudget(size_t bytes) { matrix_memory_budget_ = bytes; }
+            bool IsMatrixStreamed() const { return routing_settings_.router_type == RouterType::MATRIX && matrix_memory_budget_ && !router_; }
+            // the vertex count, the rows and the weight size of the streamed matrix, with no cells
+            RoutesSection GetStreamedMatrixLayout() const;
+            // gives the batches of rows to write_rows in order, each one is freed after the call; throws
+            // std::overflow_error if a route does not fit into the ticks, having switched to the double weights
+            void StreamRoutesMatrix(const std::function<void(const RoutesSection&)>& write_rows);
             transport_catalog_serialize::Router Serialize(bool with_graph = false) const;
-            bool Deserialize(transport_catalog_serialize::Router& router_data, bool with_graph = false);
+            // the routes matrix is read from routes_section if there is one, computed again otherwise
+            bool Deserialize(transport_catalog_serialize::Router& router_data, bool with_graph = false,
+                             std::optional<RoutesSection> routes_section = std::nullopt);
+            // empty if the router does not keep a routes matrix
+            std::optional<RoutesSection> GetRoutesMatrix() const;
+            RouterType GetRouterType() const { return routing_settings_.router_type; }
+            // the parallel edges left out by the build and the updates of this process
+            size_t GetPrunedEdgeCount() const { return pruned_edge_count_; }
+            // the added buses the routes matrix was computed again for, not updated in place
+            size_t GetMatrixRebuildCount() const { return matrix_rebuild_count_; }
+            CacheStats GetRouteCacheStats() const { return { routes_cache_->GetHitCount(), routes_cache_->GetMissCount() }; }
+
+        private:        // methods
+            std::optional<CompletedRoute> BuildCompletedRoute(graph::VertexId from, graph::VertexId to) const;
+            std::optional<CompletedRoute> BuildRaptorRoute(graph::VertexId from, graph::VertexId to) const;
+            void AddEdge(const graph::Edge<double>& edge, EdgeInfo info);
+            void NumberStops();
+            void IndexVertexStops();
+            graph::VertexId GetStopVertex(const Stop* stop) const;
+            size_t CountVertices() const;
+            double GetBusVelocity() const;
+            double GetTicksPerMinute() const;
+            // the wait of a boarding edge and the ride at the velocity of these settings
+            double GetEdgeWeight(const EdgeInfo& info) const;
+            std::vector<double> GetRideDistances(const Bus* bus) const;
+            BusEdges MakeCompleteBusEdges(const Bus* bus) const;
+            BusEdges MakeLinearBusEdges(const Bus* bus, graph::VertexId first_ride_vertex) const;
+            size_t PruneParallelEdges(std::vector<BusEdges>& batches) const;
+            size_t PruneDominatedEdges(BusEdges& bus_edges);
+            RouterType ResolveRouterType() const;
+            void CreateRouter(const transport_catalog_serialize::Router* router_data = nullptr,
+                              std::optional<RoutesSection> routes_section = std::nullopt);
+            void CreateTicksMatrix(std::optional<RoutesSection> routes_section);
+            // adds the edges from first_new_edge on to the routes matrix
+            void UpdateRoutesMatrix(graph::EdgeId first_new_edge);
+            // updates the routing data for the edges from first_new_edge on, in place if it is a routes matrix
+            void UpdateRouter(graph::EdgeId first_new_edge);
+            // a profile adds the edges of its base from first_edge on with its own weights
+            void AddBaseEdges(graph::EdgeId first_edge);
+            // the routes section holds the matrices of this router and then of its profiles, all of the same size
+            void CreateProfiles(const transport_catalog_serialize::Router* router_data = nullptr,
+                                std::optional<RoutesSection> routes_section = std::nullopt);
+            // the matrices are written as one section of a single weight type, so a route too long for the ticks
+            // in any profile takes all of them to the double weights
+            void UnifyWeightTypes();
+            const std::vector<EdgeInfo>& GetEdgeInfos() const { return base_ ? base_->edges_ : edges_; }
+            std::unique_ptr<const graph::LowerBound<double>> CreateLowerBound(const transport_catalog_serialize::Router* router_data) const;
+            std::vector<geo::Coordinates> GetVertexCoordinates() const;
         };
     }   // namespace interface
 }       // namespace tr_cat
\ No newline at end of file